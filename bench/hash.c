@@ -0,0 +1,223 @@
+/*
+ * Compares hiss_hash with the chained table it replaced, at 10, 1k and
+ * 1M keys: inserting every key into a fresh table, then looking up each
+ * of them and as many names that are not in it. The chained table runs
+ * twice, with the per-character shift hash it used to have and with the
+ * interned hash. Build with `make bench`.
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/utilities/hiss_hash.h"
+#include "../src/utilities/hiss_intern.h"
+#include "../src/utilities/type_management.h"
+
+#define OPS 1000000
+#define BATCH_OPS 100000
+#define INIT_BUCKETS 64
+
+typedef struct chained_entry{
+    const char* key;
+    const hiss_val* value;
+    struct chained_entry* next;
+}chained_entry;
+
+typedef struct{
+    unsigned long (*hash)(const char*);
+    unsigned int size;
+    unsigned int n;
+    chained_entry** table;
+}chained;
+
+static unsigned long shift_hash(const char* key){
+    unsigned long h = 0;
+
+    for(; *key; key++) h = (h << 8) + (unsigned char) *key;
+
+    return h;
+}
+
+static unsigned long interned_hash(const char* key){
+    return (unsigned long) hiss_intern_hash(key);
+}
+
+static chained* chained_new(unsigned long (*hash)(const char*)){
+    chained* t = (chained*) malloc(sizeof(chained));
+
+    t->hash = hash;
+    t->size = INIT_BUCKETS;
+    t->n = 0;
+    t->table = (chained_entry**) calloc(t->size, sizeof(chained_entry*));
+
+    return t;
+}
+
+static void chained_delete(chained* t){
+    chained_entry* e;
+    chained_entry* next;
+    unsigned int i;
+
+    for(i = 0; i < t->size; i++){
+        for(e = t->table[i]; e; e = next){
+            next = e->next;
+            free(e);
+        }
+    }
+
+    free(t->table);
+    free(t);
+}
+
+static const hiss_val* chained_get(chained* t, const char* key){
+    chained_entry* e;
+
+    for(e = t->table[t->hash(key) % t->size]; e; e = e->next)
+        if(key == e->key) return e->value;
+
+    return NULL;
+}
+
+/* Like hiss_table_insert, refuses keys that are already bound. */
+static void chained_insert(chained* t, const char* key, const hiss_val* value){
+    chained_entry* e;
+    chained_entry** old = t->table;
+    chained_entry* next;
+    unsigned int old_size = t->size;
+    unsigned long h = t->hash(key) % t->size;
+    unsigned int i;
+
+    if(chained_get(t, key)) return;
+
+    e = (chained_entry*) malloc(sizeof(chained_entry));
+    e->key = key;
+    e->value = value;
+    e->next = t->table[h];
+    t->table[h] = e;
+
+    if(++t->n < t->size) return;
+
+    t->size *= 2;
+    t->table = (chained_entry**) calloc(t->size, sizeof(chained_entry*));
+
+    for(i = 0; i < old_size; i++){
+        for(e = old[i]; e; e = next){
+            next = e->next;
+            h = t->hash(e->key) % t->size;
+            e->next = t->table[h];
+            t->table[h] = e;
+        }
+    }
+
+    free(old);
+}
+
+/* A table under test; chained tables get their hash through new. */
+typedef struct{
+    const char* name;
+    void* (*new)();
+    void (*insert)(void* t, const char* key);
+    const hiss_val* (*get)(void* t, const char* key);
+    void (*delete)(void* t);
+}table_ops;
+
+static void* ops_shift_new(){ return chained_new(shift_hash); }
+static void* ops_interned_new(){ return chained_new(interned_hash); }
+static void ops_chained_insert(void* t, const char* key){ chained_insert((chained*) t, key, hiss_val_bool(HISS_TRUE)); }
+static const hiss_val* ops_chained_get(void* t, const char* key){ return chained_get((chained*) t, key); }
+static void ops_chained_delete(void* t){ chained_delete((chained*) t); }
+
+static void* ops_table_new(){ return hiss_table_new_size(INIT_BUCKETS); }
+static void ops_table_insert(void* t, const char* key){ hiss_table_insert((hiss_hashtable*) t, key, hiss_val_bool(HISS_TRUE)); }
+static const hiss_val* ops_table_get(void* t, const char* key){ return hiss_table_get((hiss_hashtable*) t, key); }
+static void ops_table_delete(void* t){ hiss_table_delete((hiss_hashtable*) t); }
+
+static const table_ops tables[] = {
+    {"chained/shift", ops_shift_new, ops_chained_insert, ops_chained_get, ops_chained_delete},
+    {"chained/intern", ops_interned_new, ops_chained_insert, ops_chained_get, ops_chained_delete},
+    {"hiss_hash", ops_table_new, ops_table_insert, ops_table_get, ops_table_delete}
+};
+
+static double now(){
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static const char** names(const char* prefix, unsigned int n){
+    const char** keys = (const char**) malloc(sizeof(char*) * n);
+    char buf[32];
+    unsigned int i;
+
+    for(i = 0; i < n; i++){
+        snprintf(buf, sizeof(buf), "%s%u", prefix, i);
+        keys[i] = hiss_intern(buf);
+    }
+
+    return keys;
+}
+
+/*
+ * Small tables are filled in batches, so that each timed stretch is
+ * long enough for the clock.
+ */
+static void bench(const table_ops* ops, const char** keys, const char** missing, unsigned int n){
+    unsigned int batch = BATCH_OPS / n ? BATCH_OPS / n : 1;
+    unsigned int rounds = OPS / (n * batch) ? OPS / (n * batch) : 1;
+    void** t = (void**) malloc(sizeof(void*) * batch);
+    double ins = 0, hit = 0, miss = 0, start, ops_done;
+    unsigned long found = 0;
+    unsigned int r, b, i;
+
+    for(r = 0; r < rounds; r++){
+        for(b = 0; b < batch; b++) t[b] = ops->new();
+
+        start = now();
+        for(b = 0; b < batch; b++)
+            for(i = 0; i < n; i++) ops->insert(t[b], keys[i]);
+        ins += now() - start;
+
+        start = now();
+        for(b = 0; b < batch; b++)
+            for(i = 0; i < n; i++) found += ops->get(t[b], keys[i]) != NULL;
+        hit += now() - start;
+
+        start = now();
+        for(b = 0; b < batch; b++)
+            for(i = 0; i < n; i++) found += ops->get(t[b], missing[i]) != NULL;
+        miss += now() - start;
+
+        for(b = 0; b < batch; b++) ops->delete(t[b]);
+    }
+
+    free(t);
+
+    ops_done = (double) n * batch * rounds / 1e9;
+
+    if(found != (unsigned long) n * batch * rounds) printf("%s: lost keys\n", ops->name);
+    printf("%-16s %8u %10.1f %10.1f %10.1f\n", ops->name, n,
+           ins / ops_done, hit / ops_done, miss / ops_done);
+}
+
+int main(){
+    unsigned int sizes[] = {10, 1000, 1000000};
+    const char** keys;
+    const char** missing;
+    unsigned int i, j;
+
+    printf("%-16s %8s %10s %10s %10s\n", "ns/op", "keys", "insert", "hit", "miss");
+
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++){
+        keys = names("key", sizes[i]);
+        missing = names("missing", sizes[i]);
+
+        for(j = 0; j < sizeof(tables) / sizeof(tables[0]); j++)
+            bench(&tables[j], keys, missing, sizes[i]);
+
+        free(keys);
+        free(missing);
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * Parse throughput on generated files of nested S-Expressions, 64k and
+ * 512k large: mpc_parse_contents, the same with memoization
+ * (mpc_parse_contents_memo) and hiss_read, in MB/s. Checks that both
+ * mpc parses build the same tree. Build with `make bench`.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/core/mpc.h"
+#include "../src/core/grammar.h"
+#include "../src/core/reader.h"
+#include "../src/utilities/hiss_buffer.h"
+
+#define FILE_NAME "parse_bench.his"
+
+static double now(){
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+static unsigned long seed = 42;
+
+static unsigned int next(unsigned int n){
+    seed = seed * 6364136223846793005ul + 1442695040888963407ul;
+    return (unsigned int) (seed >> 33) % n;
+}
+
+static const char* atoms[] = {"foo", "-", "+", "<=", "x1", "list?", "&", "-12", "345",
+                              "\"a string\"", "\"esc\\\"aped\\n\"", "type:pair"};
+
+static void expr(hiss_buffer* b, unsigned int depth){
+    unsigned int i, n;
+    int qexpr;
+
+    if(depth == 0 || next(4) == 0){
+        hiss_buffer_append_str(b, atoms[next(sizeof(atoms) / sizeof(atoms[0]))]);
+        return;
+    }
+
+    qexpr = next(3) == 0;
+    n = 1 + next(5);
+
+    hiss_buffer_append_str(b, qexpr ? "{" : "(");
+    for(i = 0; i < n; i++){
+        if(i) hiss_buffer_append_str(b, next(8) ? " " : "\n  ");
+        expr(b, depth - 1);
+    }
+    hiss_buffer_append_str(b, qexpr ? "}" : ")");
+}
+
+/* Writes forms to FILE_NAME up to size bytes; the contents, terminated. */
+static char* generate(size_t size){
+    hiss_buffer* b = hiss_buffer_new(size + 1024);
+    char* contents;
+    FILE* f;
+
+    while(b->len < size){
+        if(next(10) == 0) hiss_buffer_append_str(b, "# a comment\n");
+        expr(b, 6);
+        hiss_buffer_append_str(b, "\n");
+    }
+
+    f = fopen(FILE_NAME, "wb");
+    fwrite(b->data, 1, b->len, f);
+    fclose(f);
+
+    contents = hiss_buffer_take(b);
+    hiss_buffer_delete(b);
+
+    return contents;
+}
+
+static mpc_ast_t* parse(int (*f)(const char*, mpc_parser_t*, mpc_result_t*), mpc_parser_t* p,
+                        double* secs){
+    mpc_result_t r;
+    double start = now();
+    int ok = f(FILE_NAME, p, &r);
+
+    *secs = now() - start;
+
+    if(!ok){
+        mpc_err_print(r.error);
+        mpc_err_delete(r.error);
+        return NULL;
+    }
+
+    return (mpc_ast_t*) r.output;
+}
+
+int main(){
+    size_t sizes[] = {64 * 1024, 512 * 1024};
+    mpc_ast_t* plain;
+    mpc_ast_t* memo;
+    double t_plain, t_memo, t_read, mb, start;
+    char* contents;
+    unsigned int i;
+
+    number = mpc_new("number");
+    symbol = mpc_new("symbol");
+    type = mpc_new("type");
+    string = mpc_new("string");
+    comment = mpc_new("comment");
+    s_expression = mpc_new("sexpr");
+    q_expression = mpc_new("qexpr");
+    expression = mpc_new("expr");
+    hiss = mpc_new("hiss");
+
+    /* the grammar of prompt.c */
+    mpca_lang(MPCA_LANG_DEFAULT,
+        "number        : /-?[0-9]+/;                              \
+         symbol        : /[a-zA-Z0-9_+\\-*\\/\\\\=<>!\\|\\:?&]+/;    \
+         type          : /type:<symbol>/;                         \
+         string        : /\"(\\\\.|[^\"])*\"/;                    \
+         comment       : /#[^\\r\\n]*/;                           \
+         sexpr         : '('<expr>*')';                           \
+         qexpr         : '{'<expr>*'}';                           \
+         expr          : <number> | <string> | <symbol> | <sexpr> | <qexpr> | <type> | <comment>;\
+         hiss          : /^/<expr>*/$/;                           \
+        ",
+    number, symbol, type, string, comment, s_expression, q_expression,
+    expression, hiss);
+
+    printf("%-8s %10s %10s %10s %10s\n", "MB/s", "bytes", "mpc", "mpc memo", "hiss_read");
+
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++){
+        contents = generate(sizes[i]);
+        mb = (double) strlen(contents) / (1024 * 1024);
+
+        /* first, the heap mpc leaves behind makes malloc slow for a while */
+        start = now();
+        if(!hiss_read(contents)) printf("hiss_read failed\n");
+        t_read = now() - start;
+
+        plain = parse(mpc_parse_contents, hiss, &t_plain);
+        memo = parse(mpc_parse_contents_memo, hiss, &t_memo);
+
+        if(!plain || !memo || !mpc_ast_eq(plain, memo)) printf("memoized parse differs\n");
+
+        printf("%-8s %10zu %10.2f %10.2f %10.2f\n", "", strlen(contents),
+               mb / t_plain, mb / t_memo, mb / t_read);
+
+        if(plain) mpc_ast_delete(plain);
+        if(memo) mpc_ast_delete(memo);
+        free(contents);
+    }
+
+    remove(FILE_NAME);
+    mpc_cleanup(9, number, symbol, type, string, comment, s_expression, q_expression,
+                expression, hiss);
+
+    return 0;
+}
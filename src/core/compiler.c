@@ -0,0 +1,297 @@
+#include "compiler.h"
+
+#include "../utilities/type_management.h"
+#include "../utilities/type_utils.h"
+
+#define INIT_CODE 16
+
+/*
+ * What the symbols of a lambda body can be resolved against: the
+ * formals of the lambda, and the environment it is created in, with
+ * the globals at its root. Code compiled without a scope looks every
+ * symbol up by name.
+ */
+typedef struct{
+    const hiss_val* formals;
+    const hiss_val* body;
+    hiss_env* env;
+}hiss_scope;
+
+static void compile_expr(hiss_chunk* c, const hiss_val* v, const hiss_scope* s, unsigned short tail);
+static void compile_sexpr(hiss_chunk* c, const hiss_val* v, const hiss_scope* s, unsigned short tail);
+
+static hiss_chunk* chunk_new(){
+    hiss_chunk* c = (hiss_chunk*) malloc(sizeof(hiss_chunk));
+
+    c->refs = 1;
+    c->count = 0;
+    c->size = INIT_CODE;
+    c->code = (unsigned int*) malloc(sizeof(unsigned int) * c->size);
+    c->nconsts = 0;
+    c->consts = NULL;
+    c->ncells = 0;
+    c->cells = NULL;
+
+    return c;
+}
+
+static unsigned int emit(hiss_chunk* c, unsigned int word){
+    if(c->count == c->size){
+        c->size *= 2;
+        c->code = (unsigned int*) realloc(c->code, sizeof(unsigned int) * c->size);
+    }
+
+    c->code[c->count] = word;
+    return c->count++;
+}
+
+static unsigned int add_const(hiss_chunk* c, hiss_val* v){
+    /* capacity is always the next power of two */
+    if((c->nconsts & (c->nconsts - 1)) == 0)
+        c->consts = (hiss_val**) realloc(c->consts, sizeof(hiss_val*) *
+                      (c->nconsts ? c->nconsts * 2 : 1));
+
+    c->consts[c->nconsts] = v;
+    return c->nconsts++;
+}
+
+static unsigned int add_cell(hiss_chunk* c, hiss_cell* cell){
+    if((c->ncells & (c->ncells - 1)) == 0)
+        c->cells = (hiss_cell**) realloc(c->cells, sizeof(hiss_cell*) *
+                     (c->ncells ? c->ncells * 2 : 1));
+
+    c->cells[c->ncells] = cell;
+    return c->ncells++;
+}
+
+/* The slot sym is bound to when the lambda runs, or -1. */
+static int formal_slot(const hiss_val* formals, const char* sym){
+    unsigned int i;
+    int slot = 0;
+
+    for(i = 0; i < formals->count; i++){
+        if(formals->cells[i]->sym == hiss_intern("&")) continue;
+        if(formals->cells[i]->sym == sym) return slot;
+        slot++;
+    }
+
+    return -1;
+}
+
+/* Whether v contains an (= {... sym ...} ...), binding sym at runtime. */
+static unsigned short is_assigned(const hiss_val* v, const char* sym){
+    unsigned int i;
+    const hiss_val* syms;
+
+    if(HISS_TYPE(v) != HISS_SEXPR && HISS_TYPE(v) != HISS_QEXPR) return HISS_FALSE;
+
+    if(v->count > 1 && HISS_TYPE(v->cells[0]) == HISS_SYM &&
+       v->cells[0]->sym == hiss_intern("=") && HISS_TYPE(v->cells[1]) == HISS_QEXPR){
+        syms = v->cells[1];
+        for(i = 0; i < syms->count; i++)
+            if(HISS_TYPE(syms->cells[i]) == HISS_SYM && syms->cells[i]->sym == sym)
+                return HISS_TRUE;
+    }
+
+    for(i = 0; i < v->count; i++)
+        if(is_assigned(v->cells[i], sym)) return HISS_TRUE;
+
+    return HISS_FALSE;
+}
+
+/*
+ * Formals become LOCAL 0, bindings of the enclosing lambda frames LOCAL
+ * with their depth and everything else a GLOBAL cell, bound or not yet.
+ * Symbols the body binds itself with '=', those an enclosing lambda's
+ * body binds with '=' but has not bound yet, and those in hash table
+ * frames, are left to LOOKUP: a global of the same name must not win
+ * over them.
+ */
+static void compile_symbol(hiss_chunk* c, const hiss_val* v, const hiss_scope* s){
+    unsigned int k = add_const(c, hiss_val_copy(v));
+    unsigned int depth, i;
+    int slot;
+    hiss_env* e;
+
+    if(!s || is_assigned(s->body, v->sym)){
+        emit(c, HISS_OP_LOOKUP);
+        emit(c, k);
+        return;
+    }
+
+    slot = formal_slot(s->formals, v->sym);
+    if(slot >= 0){
+        emit(c, HISS_OP_LOCAL);
+        emit(c, 0);
+        emit(c, (unsigned int) slot);
+        emit(c, k);
+        return;
+    }
+
+    for(e = s->env, depth = 1; e->par; e = e->par, depth++){
+        if(e->vals && hiss_table_get(e->vals, v->sym)){
+            emit(c, HISS_OP_LOOKUP);
+            emit(c, k);
+            return;
+        }
+
+        for(i = 0; i < e->n; i++){
+            if(e->slots[i].key == v->sym){
+                emit(c, HISS_OP_LOCAL);
+                emit(c, depth);
+                emit(c, i);
+                emit(c, k);
+                return;
+            }
+        }
+
+        if(e->body && is_assigned(e->body, v->sym)){
+            emit(c, HISS_OP_LOOKUP);
+            emit(c, k);
+            return;
+        }
+    }
+
+    emit(c, HISS_OP_GLOBAL);
+    emit(c, add_cell(c, hiss_env_cell(e, v->sym)));
+    emit(c, k);
+}
+
+static unsigned short is_if_form(const hiss_val* v){
+    if(v->count != 3 && v->count != 4) return HISS_FALSE;
+    if(HISS_TYPE(v->cells[0]) != HISS_SYM || v->cells[0]->sym != hiss_intern("if"))
+        return HISS_FALSE;
+    if(HISS_TYPE(v->cells[2]) != HISS_QEXPR) return HISS_FALSE;
+    if(v->count == 4 && HISS_TYPE(v->cells[3]) != HISS_QEXPR) return HISS_FALSE;
+
+    return HISS_TRUE;
+}
+
+/*
+ * Ends a branch: in tail position it returns right away, otherwise it
+ * jumps to the end of the form, which is patched in later.
+ */
+static unsigned int end_branch(hiss_chunk* c, unsigned short tail){
+    if(tail){
+        emit(c, HISS_OP_RETURN);
+        return 0;
+    }
+
+    emit(c, HISS_OP_JUMP);
+    return emit(c, 0);
+}
+
+/*
+ * (if cond {then} {else}) is compiled to both an inline version that
+ * jumps straight into the compiled branches and a generic call, in case
+ * 'if' is rebound or cond is no boolean; HISS_OP_IF picks one. The
+ * branches inherit the tail position of the form.
+ */
+static void compile_if(hiss_chunk* c, const hiss_val* v, const hiss_scope* s, unsigned short tail){
+    unsigned int at, end_then, end_else;
+
+    compile_expr(c, v->cells[0], s, HISS_FALSE);
+    compile_expr(c, v->cells[1], s, HISS_FALSE);
+
+    emit(c, HISS_OP_IF);
+    at = emit(c, 0);
+    emit(c, 0);
+
+    compile_sexpr(c, v->cells[2], s, tail);
+    end_then = end_branch(c, tail);
+
+    c->code[at] = c->count;
+    if(v->count == 4){
+        compile_sexpr(c, v->cells[3], s, tail);
+    }else{
+        emit(c, HISS_OP_CONST);
+        emit(c, add_const(c, hiss_val_qexpr()));
+    }
+    end_else = end_branch(c, tail);
+
+    c->code[at+1] = c->count;
+    compile_expr(c, v->cells[2], s, HISS_FALSE);
+    if(v->count == 4) compile_expr(c, v->cells[3], s, HISS_FALSE);
+    emit(c, tail ? HISS_OP_TAILCALL : HISS_OP_CALL);
+    emit(c, v->count);
+
+    if(!tail){
+        c->code[end_then] = c->count;
+        c->code[end_else] = c->count;
+    }
+}
+
+static void compile_sexpr(hiss_chunk* c, const hiss_val* v, const hiss_scope* s, unsigned short tail){
+    unsigned int i;
+
+    if(is_if_form(v)){
+        compile_if(c, v, s, tail);
+        return;
+    }
+
+    for(i = 0; i < v->count; i++) compile_expr(c, v->cells[i], s, HISS_FALSE);
+
+    emit(c, tail ? HISS_OP_TAILCALL : HISS_OP_CALL);
+    emit(c, v->count);
+}
+
+static void compile_expr(hiss_chunk* c, const hiss_val* v, const hiss_scope* s, unsigned short tail){
+    switch(HISS_TYPE(v)){
+        case HISS_SYM:
+            compile_symbol(c, v, s);
+            break;
+        case HISS_SEXPR:
+            compile_sexpr(c, v, s, tail);
+            break;
+        default:
+            emit(c, HISS_OP_CONST);
+            emit(c, add_const(c, hiss_val_copy(v)));
+            break;
+    }
+}
+
+hiss_chunk* hiss_compile(const hiss_val* v){
+    hiss_chunk* c = chunk_new();
+
+    compile_expr(c, v, NULL, HISS_TRUE);
+    emit(c, HISS_OP_RETURN);
+
+    return c;
+}
+
+hiss_chunk* hiss_compile_body(const hiss_val* v){
+    hiss_chunk* c = chunk_new();
+
+    compile_sexpr(c, v, NULL, HISS_TRUE);
+    emit(c, HISS_OP_RETURN);
+
+    return c;
+}
+
+hiss_chunk* hiss_compile_lambda(const hiss_val* formals, const hiss_val* body, hiss_env* e){
+    hiss_chunk* c = chunk_new();
+    hiss_scope s;
+
+    s.formals = formals;
+    s.body = body;
+    s.env = e;
+
+    compile_sexpr(c, body, &s, HISS_TRUE);
+    emit(c, HISS_OP_RETURN);
+
+    return c;
+}
+
+hiss_chunk* hiss_chunk_retain(hiss_chunk* c){
+    if(c) c->refs++;
+    return c;
+}
+
+void hiss_chunk_release(hiss_chunk* c){
+    if(!c || --c->refs) return;
+
+    free(c->consts);
+    free(c->cells);
+    free(c->code);
+    free(c);
+}
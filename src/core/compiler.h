@@ -0,0 +1,39 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "../utilities/util.h"
+#include "../types/bytecode.h"
+#include "../types/environment.h"
+#include "../types/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compiles a single expression, as hiss_val_eval would evaluate it.
+ */
+hiss_chunk* hiss_compile(const hiss_val* v);
+
+/*
+ * Compiles the cells of v as an S-Expression, regardless of whether v
+ * is an S- or a Q-Expression. This is what lambda bodies and the
+ * branches of 'if' are compiled with.
+ */
+hiss_chunk* hiss_compile_body(const hiss_val* v);
+
+/*
+ * Compiles the body of a lambda created in environment e. Symbols are
+ * resolved now, to slots of the lambda's frame or of the frames around
+ * it, or to global cells; see HISS_OP_LOCAL and HISS_OP_GLOBAL.
+ */
+hiss_chunk* hiss_compile_lambda(const hiss_val* formals, const hiss_val* body, hiss_env* e);
+
+hiss_chunk* hiss_chunk_retain(hiss_chunk* c);
+void hiss_chunk_release(hiss_chunk* c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,37 +1,253 @@
 #include "gc.h"
 
-static void mark(hiss_entry* v){
-    if(v->marked) return;
+#include "vm.h"
+#include "../utilities/hiss_hash.h"
+#include "../utilities/type_management.h"
+
+#define INIT_ROOTS 16
+#define SLAB_SIZE 512
+
+static hiss_val* heap = NULL;
+static hiss_val* free_vals = NULL;
+static hiss_env* envs = NULL;
+static unsigned long live = 0;
+static unsigned long traced = 0;
+static unsigned long allocated = 0;
+static unsigned long treshold = GC_TRESHOLD;
+static unsigned long epoch = 0;
+
+static hiss_env** roots = NULL;
+static unsigned int nroots = 0;
+static unsigned int roots_size = 0;
+
+static hiss_val** protected = NULL;
+static unsigned int nprotected = 0;
+static unsigned int protected_size = 0;
+
+static hiss_val** gray = NULL;
+static unsigned int ngray = 0;
+static unsigned int gray_size = 0;
+
+/*
+ * Values are carved out of slabs of SLAB_SIZE nodes. Swept nodes are
+ * kept on a free list threaded through next and handed out again before
+ * a new slab is allocated; slabs are never returned to the system.
+ */
+static void new_slab(){
+    unsigned int i;
+    hiss_val* slab = (hiss_val*) malloc(sizeof(hiss_val) * SLAB_SIZE);
+
+    assert(slab != 0);
+
+    for(i = 0; i < SLAB_SIZE; i++){
+        slab[i].next = free_vals;
+        free_vals = &slab[i];
+    }
+}
+
+hiss_val* hiss_gc_alloc(){
+    hiss_val* v;
+
+    if(!free_vals) new_slab();
+
+    v = free_vals;
+    free_vals = v->next;
+
+    memset(v, 0, sizeof(hiss_val));
+    v->next = heap;
+    heap = v;
+    allocated++;
+
+    return v;
+}
+
+void hiss_gc_track_env(hiss_env* e){
+    e->marked = 0;
+    e->next = envs;
+    envs = e;
+}
+
+void hiss_gc_add_root(hiss_env* e){
+    if(nroots == roots_size){
+        roots_size = roots_size ? roots_size * 2 : INIT_ROOTS;
+        roots = (hiss_env**) realloc(roots, sizeof(hiss_env*) * roots_size);
+    }
+
+    roots[nroots++] = e;
+}
+
+void hiss_gc_remove_root(hiss_env* e){
+    unsigned int i;
+
+    for(i = 0; i < nroots; i++){
+        if(roots[i] == e){
+            roots[i] = roots[--nroots];
+            return;
+        }
+    }
+}
+
+void hiss_gc_protect(hiss_val* v){
+    if(nprotected == protected_size){
+        protected_size = protected_size ? protected_size * 2 : INIT_ROOTS;
+        protected = (hiss_val**) realloc(protected, sizeof(hiss_val*) * protected_size);
+    }
+
+    protected[nprotected++] = v;
+}
+
+void hiss_gc_unprotect(unsigned int n){
+    nprotected -= n;
+}
+
+void hiss_gc_mark(hiss_val* v){
+    if(!v || HISS_IS_IMM(v) || v->marked) return;
 
     v->marked = HISS_TRUE;
+
+    if(ngray == gray_size){
+        gray_size = gray_size ? gray_size * 2 : INIT_ROOTS;
+        gray = (hiss_val**) realloc(gray, sizeof(hiss_val*) * gray_size);
+    }
+
+    gray[ngray++] = v;
+}
+
+/* Marks e and the environments it was created in. */
+void hiss_gc_mark_env(hiss_env* e){
+    unsigned int i;
+    const hiss_entry* entry;
+    const hiss_type_entry* type;
+
+    for(; e && e->marked != epoch; e = e->par){
+        e->marked = epoch;
+        hiss_gc_mark((hiss_val*) e->body);
+
+        for(i = 0; i < e->n; i++) hiss_gc_mark((hiss_val*) e->slots[i].value);
+
+        if(e->vals)
+            for(i = 0; (entry = hiss_table_next(e->vals, &i)); )
+                hiss_gc_mark((hiss_val*) entry->value);
+
+        if(e->types){
+            for(i = 0; i < e->types->size; i++)
+                for(type = e->types->table[i]; type; type = type->next)
+                    hiss_gc_mark((hiss_val*) type->value);
+
+            /* the buckets still to move when the table is growing */
+            for(i = 0; i < e->types->old_size; i++)
+                for(type = e->types->old[i]; type; type = type->next)
+                    hiss_gc_mark((hiss_val*) type->value);
+        }
+    }
 }
 
-static void mark_all(hiss_hashtable* t){
+void hiss_gc_mark_chunk(const hiss_chunk* c){
     unsigned int i;
 
-    for(i = 0; i < t->size; i++)
-        mark(t->table[i]);
+    if(!c) return;
+
+    for(i = 0; i < c->nconsts; i++) hiss_gc_mark(c->consts[i]);
 }
 
-static void sweep(hiss_hashtable* t){
-    hiss_entry* unreached;
-    hiss_entry** e = t->table;
+static void trace(hiss_val* v){
+    unsigned int i;
+    const hiss_entry* entry;
+
+    switch(v->type){
+        case HISS_SEXPR:
+        case HISS_QEXPR:
+        case HISS_VEC:
+            for(i = 0; i < v->count; i++) hiss_gc_mark(v->cells[i]);
+            hiss_gc_mark(v->base);
+            traced += v->count;
+            break;
+        case HISS_STR:
+            hiss_gc_mark(v->base);
+            break;
+        case HISS_DICT:
+            for(i = 0; (entry = hiss_table_next(v->table, &i)); )
+                hiss_gc_mark((hiss_val*) entry->value);
+            traced += v->count;
+            break;
+        case HISS_USR:
+            hiss_gc_mark(v->formals);
+            break;
+        case HISS_FUN:
+            if(!v->fun){
+                hiss_gc_mark(v->formals);
+                hiss_gc_mark(v->body);
+                hiss_gc_mark_env(v->env);
+                hiss_gc_mark_chunk(v->code);
+            }
+            break;
+        default: break;
+    }
+}
+
+static void mark_all(){
+    unsigned int i;
+
+    epoch++;
+    traced = 0;
+
+    for(i = 0; i < nroots; i++) hiss_gc_mark_env(roots[i]);
+    for(i = 0; i < nprotected; i++) hiss_gc_mark(protected[i]);
+    hiss_vm_mark();
+
+    while(ngray) trace(gray[--ngray]);
+}
+
+static void sweep(){
+    hiss_val* unreached;
+    hiss_val** v = &heap;
+
+    live = 0;
+
+    while(*v){
+        if(!(*v)->marked){
+            unreached = *v;
+            *v = unreached->next;
+            hiss_val_del(unreached);
+            unreached->next = free_vals;
+            free_vals = unreached;
+        }else{
+            (*v)->marked = HISS_FALSE;
+            v = &(*v)->next;
+            live++;
+        }
+    }
+}
+
+static void sweep_envs(){
+    hiss_env* unreached;
+    hiss_env** e = &envs;
 
     while(*e){
-        if(!(*e)->marked){
+        if((*e)->marked != epoch){
             unreached = *e;
-
             *e = unreached->next;
-            hiss_table_remove(t, unreached->key);
+            hiss_env_del(unreached);
         }else{
-            (*e)->marked = 0;
             e = &(*e)->next;
         }
     }
 }
 
-void gc(hiss_hashtable* t){
-    mark_all(t);
-    sweep(t);
+void hiss_gc_collect(){
+    mark_all();
+    sweep();
+    sweep_envs();
+
+    /*
+     * The next collection waits for as many allocations as this one had
+     * work, counting the cells it went through, so that a few long lists
+     * are not traced over and over.
+     */
+    allocated = 0;
+    treshold = live + traced > GC_TRESHOLD ? live + traced : GC_TRESHOLD;
 }
 
+void hiss_gc_poll(){
+    if(allocated >= treshold) hiss_gc_collect();
+}
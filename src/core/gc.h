@@ -1,15 +1,38 @@
 #ifndef GC
 #define GC
 
+#include <assert.h>
+
 #include "../utilities/util.h"
-#include "../utilities/hiss_hash.h"
-#include "../types/tables.h"
+#include "../types/bytecode.h"
+#include "../types/environment.h"
+#include "../types/types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void gc(hiss_hashtable* t);
+/*
+ * Every hiss_val and hiss_env is owned by the collector. Collections only happen at
+ * safe points of the VM (hiss_gc_poll), where the live values are the
+ * root environments, the VM stack and frames, and whatever C code has
+ * protected while it evaluates.
+ */
+
+hiss_val* hiss_gc_alloc();
+void hiss_gc_track_env(hiss_env* e);
+
+void hiss_gc_add_root(hiss_env* e);
+void hiss_gc_remove_root(hiss_env* e);
+void hiss_gc_protect(hiss_val* v);
+void hiss_gc_unprotect(unsigned int n);
+
+void hiss_gc_mark(hiss_val* v);
+void hiss_gc_mark_env(hiss_env* e);
+void hiss_gc_mark_chunk(const hiss_chunk* c);
+
+void hiss_gc_poll();
+void hiss_gc_collect();
 
 #ifdef __cplusplus
 }
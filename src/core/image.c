@@ -0,0 +1,1012 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "image.h"
+#include "compiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../utilities/hiss_buffer.h"
+#include "../utilities/hiss_cells.h"
+#include "../utilities/type_management.h"
+#include "../utilities/type_utils.h"
+
+#define MAGIC "HISC"
+#define VERSION 1
+/* reads back as another number on a machine of the other byte order */
+#define BYTE_ORDER_MARK 0x01020304u
+
+typedef struct{
+    char magic[4];
+    uint32_t version;
+    uint32_t bom;
+    uint32_t unused;
+    uint64_t size;
+    uint64_t hash;
+}hiss_image_header;
+
+/* The tags of the values in an image. */
+enum{IMG_NUM = 'n', IMG_STR = 's', IMG_SYM = 'y', IMG_SEXPR = '(', IMG_QEXPR = '{'};
+
+char* hiss_image_name(const char* fname){
+    size_t len = strlen(fname);
+    char* name = (char*) malloc(len + 2);
+
+    memcpy(name, fname, len);
+    name[len] = 'c';
+    name[len+1] = '\0';
+
+    return name;
+}
+
+#ifndef _WIN32
+
+static void put_u32(hiss_buffer* b, uint32_t n){
+    hiss_buffer_append(b, (const char*) &n, sizeof(n));
+}
+
+static int put(hiss_buffer* b, const hiss_val* v){
+    unsigned int i;
+    char tag;
+    int64_t n;
+
+    switch(HISS_TYPE(v)){
+        case HISS_NUM:
+            tag = IMG_NUM;
+            n = HISS_NUM_OF(v);
+            hiss_buffer_append(b, &tag, 1);
+            hiss_buffer_append(b, (const char*) &n, sizeof(n));
+            return 1;
+        case HISS_STR:
+            tag = IMG_STR;
+            hiss_buffer_append(b, &tag, 1);
+            put_u32(b, v->count);
+            hiss_buffer_append(b, v->str, v->count);
+            return 1;
+        case HISS_SYM:
+            tag = IMG_SYM;
+            hiss_buffer_append(b, &tag, 1);
+            put_u32(b, (uint32_t) strlen(v->sym));
+            hiss_buffer_append_str(b, v->sym);
+            return 1;
+        case HISS_SEXPR:
+        case HISS_QEXPR:
+            tag = HISS_TYPE(v) == HISS_SEXPR ? IMG_SEXPR : IMG_QEXPR;
+            hiss_buffer_append(b, &tag, 1);
+            put_u32(b, v->count);
+
+            for(i = 0; i < v->count; i++)
+                if(!put(b, v->cells[i])) return 0;
+
+            return 1;
+        default:
+            /* nothing else comes out of the reader */
+            return 0;
+    }
+}
+
+/* Where the bytes of an image are read from, up to end. */
+typedef struct{
+    const char* p;
+    const char* end;
+}hiss_image_input;
+
+static int get_u32(hiss_image_input* in, uint32_t* n){
+    if((size_t) (in->end - in->p) < sizeof(*n)) return 0;
+
+    memcpy(n, in->p, sizeof(*n));
+    in->p += sizeof(*n);
+
+    return 1;
+}
+
+/* The next value of in, NULL if the image is broken. */
+static hiss_val* get(hiss_image_input* in){
+    hiss_val* v;
+    hiss_val* x;
+    int64_t n;
+    uint32_t count;
+    uint32_t i;
+    char tag;
+
+    if(in->p == in->end) return NULL;
+
+    tag = *in->p++;
+
+    if(tag == IMG_NUM){
+        if((size_t) (in->end - in->p) < sizeof(n)) return NULL;
+
+        memcpy(&n, in->p, sizeof(n));
+        in->p += sizeof(n);
+
+        return hiss_val_num((long) n);
+    }
+
+    if(!get_u32(in, &count)) return NULL;
+
+    switch(tag){
+        case IMG_STR:
+        case IMG_SYM:
+            if((size_t) (in->end - in->p) < count) return NULL;
+
+            v = tag == IMG_STR ? hiss_val_str_len(in->p, count) : hiss_val_sym_len(in->p, count);
+            in->p += count;
+
+            return v;
+        case IMG_SEXPR:
+        case IMG_QEXPR:
+            v = tag == IMG_SEXPR ? hiss_val_sexpr() : hiss_val_qexpr();
+            /* every value takes at least a byte */
+            if((size_t) (in->end - in->p) < count) return NULL;
+
+            hiss_cells_reserve(v, count);
+            for(i = 0; i < count; i++){
+                x = get(in);
+                if(!x) return NULL;
+
+                v->cells[v->count++] = x;
+            }
+
+            return v;
+        default:
+            return NULL;
+    }
+}
+
+hiss_val* hiss_image_load(const char* image, size_t size, uint64_t hash){
+    hiss_image_header h;
+    hiss_image_input in;
+    hiss_val* v = NULL;
+    struct stat st;
+    void* map;
+    int fd = open(image, O_RDONLY);
+
+    if(fd < 0) return NULL;
+
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(h)){
+        close(fd);
+        return NULL;
+    }
+
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) return NULL;
+
+    memcpy(&h, map, sizeof(h));
+
+    if(memcmp(h.magic, MAGIC, sizeof(h.magic)) == 0 && h.version == VERSION &&
+       h.bom == BYTE_ORDER_MARK && h.size == size && h.hash == hash){
+        in.p = (const char*) map + sizeof(h);
+        in.end = (const char*) map + st.st_size;
+
+        v = get(&in);
+        if(v && (HISS_TYPE(v) != HISS_SEXPR || in.p != in.end)) v = NULL;
+    }
+
+    munmap(map, (size_t) st.st_size);
+
+    return v;
+}
+
+int hiss_image_save(const char* image, const hiss_val* v, size_t size, uint64_t hash){
+    hiss_image_header h;
+    hiss_buffer* b = hiss_buffer_new(4096);
+    char* tmp = (char*) malloc(strlen(image) + 32);
+    FILE* f;
+    int ok;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = VERSION;
+    h.bom = BYTE_ORDER_MARK;
+    h.size = size;
+    h.hash = hash;
+
+    hiss_buffer_append(b, (const char*) &h, sizeof(h));
+    ok = put(b, v);
+
+    /* written aside and moved into place, so no one maps half of it */
+    sprintf(tmp, "%s.%ld", image, (long) getpid());
+    f = ok ? fopen(tmp, "wb") : NULL;
+
+    if(f){
+        ok = fwrite(b->data, 1, b->len, f) == b->len;
+        ok = fclose(f) == 0 && ok;
+        ok = ok && rename(tmp, image) == 0;
+
+        if(!ok) remove(tmp);
+    }else{
+        ok = 0;
+    }
+
+    free(tmp);
+    hiss_buffer_delete(b);
+
+    return ok;
+}
+
+/*
+ * Heap images
+ *
+ * The objects of a heap image are the values, environments and chunks
+ * reachable from the environment it was dumped from, which is object 0.
+ * After the header come the number of objects, one kind byte per object
+ * and then the objects in the same order. Objects refer to each other
+ * by index, so restoring allocates all of them first and fills them in
+ * after, whatever cycles there are between them. Last come the paths
+ * of the modules loaded.
+ *
+ * Values are referred to by a tag: IMG_REF and an index, an immediate,
+ * or IMG_NONE. Lists and strings that share storage with others are
+ * stored as copies. Builtins are stored by name and the global cells of
+ * chunks by the name they are bound to, to be found again in the
+ * process restoring the image.
+ */
+
+#define HEAP_MAGIC "HISH"
+#define HEAP_VERSION 2
+
+enum{IMG_ERR = 'e', IMG_VEC = 'v', IMG_DICT = 'd', IMG_BUF = 'b', IMG_USR = 'u',
+     IMG_BUILTIN = 'f', IMG_LAMBDA = 'l', IMG_ENV = 'E', IMG_CHUNK = 'C'};
+enum{IMG_NONE = '0', IMG_REF = 'r', IMG_IMM_NUM = 'i', IMG_IMM_BOOL = 'B'};
+
+/* The objects being dumped, and the index of each, by its address. */
+typedef struct{
+    const void** objs;
+    char* kinds;
+    unsigned int n;
+    unsigned int size;
+    const void** keys;
+    unsigned int* index;
+    unsigned int nkeys;
+}hiss_heap_dump;
+
+static size_t ptr_slot(const void* p, unsigned int size){
+    return (size_t) ((((uintptr_t) p >> 4) * 0x9E3779B97F4A7C15ull) & (size - 1));
+}
+
+static void index_grow(hiss_heap_dump* d){
+    const void** keys = d->keys;
+    unsigned int* index = d->index;
+    unsigned int size = d->nkeys;
+    unsigned int i;
+    size_t j;
+
+    d->nkeys = size ? size * 2 : 256;
+    d->keys = (const void**) calloc(d->nkeys, sizeof(void*));
+    d->index = (unsigned int*) malloc(sizeof(unsigned int) * d->nkeys);
+
+    for(i = 0; i < size; i++){
+        if(!keys[i]) continue;
+
+        for(j = ptr_slot(keys[i], d->nkeys); d->keys[j]; j = (j + 1) & (d->nkeys - 1));
+        d->keys[j] = keys[i];
+        d->index[j] = index[i];
+    }
+
+    free(keys);
+    free(index);
+}
+
+/* The index of the object at p, added as kind if it is new. */
+static unsigned int object(hiss_heap_dump* d, const void* p, char kind){
+    size_t j;
+
+    if(d->n * 2 >= d->nkeys) index_grow(d);
+
+    for(j = ptr_slot(p, d->nkeys); d->keys[j]; j = (j + 1) & (d->nkeys - 1))
+        if(d->keys[j] == p) return d->index[j];
+
+    if(d->n == d->size){
+        d->size = d->size ? d->size * 2 : 256;
+        d->objs = (const void**) realloc(d->objs, sizeof(void*) * d->size);
+        d->kinds = (char*) realloc(d->kinds, d->size);
+    }
+
+    d->keys[j] = p;
+    d->index[j] = d->n;
+    d->objs[d->n] = p;
+    d->kinds[d->n] = kind;
+
+    return d->n++;
+}
+
+static void put_bytes(hiss_buffer* b, const char* s, size_t n){
+    put_u32(b, (uint32_t) n);
+    hiss_buffer_append(b, s, n);
+}
+
+static void put_name(hiss_buffer* b, const char* s){
+    put_bytes(b, s, strlen(s));
+}
+
+static void put_ref(hiss_heap_dump* d, hiss_buffer* b, const hiss_val* v){
+    char tag;
+    int64_t n;
+
+    if(!v){
+        tag = IMG_NONE;
+        hiss_buffer_append(b, &tag, 1);
+        return;
+    }
+
+    if(HISS_IS_IMM(v)){
+        tag = HISS_TYPE(v) == HISS_NUM ? IMG_IMM_NUM : IMG_IMM_BOOL;
+        n = HISS_TYPE(v) == HISS_NUM ? HISS_NUM_OF(v) : HISS_BOOL_OF(v);
+        hiss_buffer_append(b, &tag, 1);
+        hiss_buffer_append(b, (const char*) &n, sizeof(n));
+        return;
+    }
+
+    switch(v->type){
+        case HISS_NUM: tag = IMG_NUM; break;
+        case HISS_STR: tag = IMG_STR; break;
+        case HISS_SYM: tag = IMG_SYM; break;
+        case HISS_ERR: tag = IMG_ERR; break;
+        case HISS_SEXPR: tag = IMG_SEXPR; break;
+        case HISS_QEXPR: tag = IMG_QEXPR; break;
+        case HISS_VEC: tag = IMG_VEC; break;
+        case HISS_DICT: tag = IMG_DICT; break;
+        case HISS_BUF: tag = IMG_BUF; break;
+        case HISS_USR: tag = IMG_USR; break;
+        default: tag = v->fun ? IMG_BUILTIN : IMG_LAMBDA; break;
+    }
+
+    n = object(d, v, tag);
+    tag = IMG_REF;
+    hiss_buffer_append(b, &tag, 1);
+    put_u32(b, (uint32_t) n);
+}
+
+/* An index plus one, 0 for none. */
+static void put_index(hiss_heap_dump* d, hiss_buffer* b, const void* p, char kind){
+    put_u32(b, p ? object(d, p, kind) + 1 : 0);
+}
+
+/* The symbol each global cell of c is looked up as. */
+static const char** cell_names(const hiss_chunk* c){
+    const char** names = (const char**) calloc(c->ncells ? c->ncells : 1, sizeof(char*));
+    unsigned int pc = 0;
+
+    while(pc < c->count){
+        switch(c->code[pc]){
+            case HISS_OP_GLOBAL:
+                names[c->code[pc+1]] = c->consts[c->code[pc+2]]->sym;
+                pc += 3;
+                break;
+            case HISS_OP_LOCAL: pc += 4; break;
+            case HISS_OP_IF: pc += 3; break;
+            case HISS_OP_RETURN: pc += 1; break;
+            default: pc += 2; break;
+        }
+    }
+
+    return names;
+}
+
+static void put_env(hiss_heap_dump* d, hiss_buffer* b, const hiss_env* e){
+    const hiss_entry* entry;
+    const hiss_type_entry* type;
+    unsigned int i, n;
+
+    put_index(d, b, e->par, IMG_ENV);
+    put_ref(d, b, e->body);
+
+    put_u32(b, e->n);
+    for(i = 0; i < e->n; i++){
+        put_name(b, e->slots[i].key);
+        put_ref(d, b, e->slots[i].value);
+    }
+
+    n = 0;
+    if(e->vals)
+        for(i = 0; (entry = hiss_table_next(e->vals, &i)); )
+            if(entry->value) n++;
+
+    put_u32(b, e->vals ? n + 1 : 0);
+    if(e->vals){
+        for(i = 0; (entry = hiss_table_next(e->vals, &i)); ){
+            if(!entry->value) continue;
+
+            put_name(b, entry->key);
+            put_ref(d, b, entry->value);
+        }
+    }
+
+    put_u32(b, e->types ? e->types->n : 0);
+    if(!e->types) return;
+
+    for(n = 0; n < e->types->size + e->types->old_size; n++){
+        type = n < e->types->size ? e->types->table[n] : e->types->old[n - e->types->size];
+
+        for(; type; type = type->next){
+            put_name(b, type->key);
+            put_ref(d, b, type->value);
+        }
+    }
+}
+
+static void put_chunk(hiss_heap_dump* d, hiss_buffer* b, const hiss_chunk* c){
+    const char** names = cell_names(c);
+    unsigned int i;
+
+    put_u32(b, c->count);
+    hiss_buffer_append(b, (const char*) c->code, sizeof(unsigned int) * c->count);
+
+    put_u32(b, c->nconsts);
+    for(i = 0; i < c->nconsts; i++) put_ref(d, b, c->consts[i]);
+
+    put_u32(b, c->ncells);
+    for(i = 0; i < c->ncells; i++) put_name(b, names[i] ? names[i] : "");
+
+    free(names);
+}
+
+static void put_object(hiss_heap_dump* d, hiss_buffer* b, unsigned int i){
+    const hiss_val* v = (const hiss_val*) d->objs[i];
+    const hiss_entry* entry;
+    unsigned int j;
+    int64_t n;
+
+    switch(d->kinds[i]){
+        case IMG_ENV:
+            put_env(d, b, (const hiss_env*) d->objs[i]);
+            break;
+        case IMG_CHUNK:
+            put_chunk(d, b, (const hiss_chunk*) d->objs[i]);
+            break;
+        case IMG_NUM:
+            n = v->num;
+            hiss_buffer_append(b, (const char*) &n, sizeof(n));
+            break;
+        case IMG_STR: put_bytes(b, v->str, v->count); break;
+        case IMG_SYM: put_name(b, v->sym); break;
+        case IMG_ERR: put_name(b, v->err); break;
+        case IMG_BUF: put_bytes(b, v->buf->data, v->buf->len); break;
+        case IMG_SEXPR:
+        case IMG_QEXPR:
+        case IMG_VEC:
+            put_u32(b, v->count);
+            for(j = 0; j < v->count; j++) put_ref(d, b, v->cells[j]);
+            break;
+        case IMG_DICT:
+            /* the same size lists the keys in the same order again */
+            put_u32(b, v->table->cur.size);
+            put_u32(b, v->count);
+            for(j = 0; (entry = hiss_table_next(v->table, &j)); ){
+                if(!entry->value) continue;
+
+                put_bytes(b, entry->key, entry->len);
+                put_ref(d, b, entry->value);
+            }
+            break;
+        case IMG_USR:
+            put_name(b, v->type_name);
+            put_ref(d, b, v->formals);
+            break;
+        case IMG_BUILTIN:
+            put_name(b, hiss_builtin_name(v->fun) ? hiss_builtin_name(v->fun) : "");
+            break;
+        case IMG_LAMBDA:
+            put_index(d, b, v->env, IMG_ENV);
+            put_ref(d, b, v->formals);
+            put_ref(d, b, v->body);
+            put_index(d, b, v->code, IMG_CHUNK);
+            break;
+    }
+}
+
+int hiss_image_dump(const char* fname, hiss_env* e){
+    hiss_image_header h;
+    hiss_heap_dump d;
+    hiss_buffer* objs = hiss_buffer_new(1 << 16);
+    hiss_buffer* b = hiss_buffer_new(1 << 16);
+    const hiss_entry* entry;
+    unsigned int i, n;
+    FILE* f;
+    int ok;
+
+    memset(&d, 0, sizeof(d));
+    object(&d, e, IMG_ENV);
+
+    /* putting an object adds the ones it refers to behind it */
+    for(i = 0; i < d.n; i++) put_object(&d, objs, i);
+
+    for(i = 0, n = 0; (entry = hiss_table_next(hiss_modules(), &i)); )
+        if(entry->value) n++;
+
+    put_u32(objs, n);
+    for(i = 0; (entry = hiss_table_next(hiss_modules(), &i)); )
+        if(entry->value) put_name(objs, entry->key);
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, HEAP_MAGIC, sizeof(h.magic));
+    h.version = HEAP_VERSION;
+    h.bom = BYTE_ORDER_MARK;
+    h.size = d.n;
+
+    hiss_buffer_append(b, (const char*) &h, sizeof(h));
+    put_u32(b, d.n);
+    hiss_buffer_append(b, d.kinds, d.n);
+    hiss_buffer_append(b, objs->data, objs->len);
+
+    /* the hash covers everything behind the header */
+    h.hash = hiss_hash_bytes(b->data + sizeof(h), b->len - sizeof(h));
+    memcpy(b->data, &h, sizeof(h));
+
+    f = fopen(fname, "wb");
+    ok = f && fwrite(b->data, 1, b->len, f) == b->len;
+    if(f) ok = fclose(f) == 0 && ok;
+
+    free(d.objs);
+    free(d.kinds);
+    free(d.keys);
+    free(d.index);
+    hiss_buffer_delete(objs);
+    hiss_buffer_delete(b);
+
+    return ok;
+}
+
+/* What restoring an image has made so far. */
+typedef struct{
+    hiss_image_input in;
+    hiss_env* e;
+    uint32_t n;
+    const char* kinds;
+    void** objs;
+}hiss_heap_restore;
+
+static const char* get_name(hiss_image_input* in, uint32_t* len){
+    const char* s;
+
+    if(!get_u32(in, len) || (size_t) (in->end - in->p) < *len) return NULL;
+
+    s = in->p;
+    in->p += *len;
+
+    return s;
+}
+
+static const char* get_interned(hiss_image_input* in){
+    uint32_t len;
+    const char* s = get_name(in, &len);
+
+    return s ? hiss_intern_len(s, len) : NULL;
+}
+
+static char* get_copy(hiss_image_input* in, uint32_t* len){
+    const char* s = get_name(in, len);
+    char* copy;
+
+    if(!s) return NULL;
+
+    copy = (char*) malloc(*len + 1);
+    memcpy(copy, s, *len);
+    copy[*len] = '\0';
+
+    return copy;
+}
+
+/* The object index plus one at in, of kind; 0 for none, -1 if broken. */
+static long get_index(hiss_heap_restore* r, char kind){
+    uint32_t i;
+
+    if(!get_u32(&r->in, &i) || i > r->n || (i && r->kinds[i-1] != kind)) return -1;
+
+    return (long) i;
+}
+
+static int get_ref(hiss_heap_restore* r, hiss_val** v){
+    const char* kinds = "nsye({vdbufl";
+    int64_t n;
+    uint32_t i;
+    char tag;
+
+    if(r->in.p == r->in.end) return 0;
+    tag = *r->in.p++;
+
+    switch(tag){
+        case IMG_NONE:
+            *v = NULL;
+            return 1;
+        case IMG_IMM_NUM:
+        case IMG_IMM_BOOL:
+            if((size_t) (r->in.end - r->in.p) < sizeof(n)) return 0;
+
+            memcpy(&n, r->in.p, sizeof(n));
+            r->in.p += sizeof(n);
+
+            *v = tag == IMG_IMM_NUM ? hiss_val_num((long) n) : hiss_val_bool((unsigned short) n);
+            return 1;
+        case IMG_REF:
+            if(!get_u32(&r->in, &i) || i >= r->n || !strchr(kinds, r->kinds[i])) return 0;
+
+            *v = (hiss_val*) r->objs[i];
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Fills in the environment at index i, binding into r->e for index 0. */
+static int get_env(hiss_heap_restore* r, uint32_t i){
+    hiss_env* e = (hiss_env*) r->objs[i];
+    hiss_val* v;
+    hiss_val* type;
+    const char* key;
+    uint32_t n, j;
+    long par = get_index(r, IMG_ENV);
+
+    if(par < 0 || (i == 0 && par) || !get_ref(r, &v)) return 0;
+    if(par) e->par = (hiss_env*) r->objs[par-1];
+    if(i != 0) e->body = v;
+
+    if(!get_u32(&r->in, &n) || n > HISS_ENV_SLOTS) return 0;
+
+    for(j = 0; j < n; j++){
+        if(!(key = get_interned(&r->in)) || !get_ref(r, &v) || !v) return 0;
+
+        if(i == 0){
+            *hiss_env_cell(e, key) = v;
+        }else{
+            e->slots[e->n].key = key;
+            e->slots[e->n++].value = v;
+        }
+    }
+
+    /* a promoted frame, its table sized to its entries like promote's */
+    if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) < n) return 0;
+    if(n && i != 0) e->vals = hiss_table_new_size(n > HISS_ENV_SLOTS * 4 ? 2 * n : HISS_ENV_SLOTS * 8);
+
+    for(j = 1; j < n; j++){
+        if(!(key = get_interned(&r->in)) || !get_ref(r, &v) || !v) return 0;
+
+        if(i == 0) *hiss_env_cell(e, key) = v;
+        else if(HISS_TYPE(hiss_table_insert(e->vals, key, v)) == HISS_ERR) return 0;
+    }
+
+    if(!get_u32(&r->in, &n)) return 0;
+
+    for(j = 0; j < n; j++){
+        if(!(key = get_interned(&r->in)) || !get_ref(r, &type) || !type) return 0;
+
+        /* types are found by the very name they were made with */
+        if(HISS_TYPE(type) == HISS_USR && type->type_name && strcmp(type->type_name, key) == 0)
+            key = type->type_name;
+
+        hiss_type_insert(hiss_env_types(e), key, type);
+    }
+
+    return 1;
+}
+
+/* The words of each instruction, operands included. */
+static const unsigned int op_words[] = {2, 2, 4, 3, 2, 2, 3, 2, 1};
+
+/* Whether constant k of c is a symbol, as LOOKUP, LOCAL and GLOBAL need. */
+static int symbol_const(const hiss_chunk* c, unsigned int k){
+    return k < c->nconsts && c->consts[k] && HISS_TYPE(c->consts[k]) == HISS_SYM;
+}
+
+/*
+ * Records that instruction to is reached with sp values on the stack;
+ * whether every other way there leaves as many. Unreachable code, with
+ * sp below 0, is not counted.
+ */
+static int reach(unsigned int* depth, unsigned int to, long sp){
+    if(sp < 0) return 1;
+    if(depth[to] && (long) depth[to] != sp + 1) return 0;
+
+    depth[to] = (unsigned int) sp + 1;
+    return 1;
+}
+
+/*
+ * Whether the code of c could have come from the compiler: known
+ * instructions with all their operands, constants and cells in range,
+ * and jumps forward to the start of an instruction. The values on the
+ * stack are counted along, so that no instruction takes more than the
+ * chunk pushed, RETURN finds just its result and no path runs off the
+ * end; depth holds the count plus one at the targets seen so far.
+ */
+static int valid_code(const hiss_chunk* c){
+    unsigned int* depth = (unsigned int*) calloc(c->count ? c->count : 1, sizeof(unsigned int));
+    const unsigned int* a;
+    unsigned int pc, op, i, len, take, push;
+    long sp = 0;
+    int ok = 1;
+
+    for(pc = 0; ok && pc < c->count; pc += len){
+        op = c->code[pc];
+        if(op > HISS_OP_RETURN || op_words[op] > c->count - pc){
+            ok = 0;
+            break;
+        }
+
+        len = op_words[op];
+        a = &c->code[pc+1];
+        take = push = 0;
+
+        if(depth[pc]){
+            ok = sp < 0 || sp + 1 == (long) depth[pc];
+            sp = (long) depth[pc] - 1;
+        }
+
+        switch(op){
+            case HISS_OP_CONST:
+                ok = ok && a[0] < c->nconsts && c->consts[a[0]];
+                push = 1;
+                break;
+            case HISS_OP_LOOKUP:
+                ok = ok && symbol_const(c, a[0]);
+                push = 1;
+                break;
+            case HISS_OP_LOCAL:
+                ok = ok && symbol_const(c, a[2]);
+                push = 1;
+                break;
+            case HISS_OP_GLOBAL:
+                ok = ok && a[0] < c->ncells && symbol_const(c, a[1]);
+                push = 1;
+                break;
+            case HISS_OP_CALL:
+            case HISS_OP_TAILCALL:
+                take = a[0];
+                push = 1;
+                break;
+            case HISS_OP_IF:
+                /* the else branch without the two values checked, the
+                   generic call with them */
+                take = 2;
+                ok = ok && (sp < 0 || sp >= 2) &&
+                     a[0] >= pc + len && a[0] < c->count && a[1] >= pc + len && a[1] < c->count &&
+                     reach(depth, a[0], sp < 0 ? sp : sp - 2) && reach(depth, a[1], sp);
+                break;
+            case HISS_OP_JUMP:
+                ok = ok && a[0] >= pc + len && a[0] < c->count && reach(depth, a[0], sp);
+                break;
+            case HISS_OP_RETURN:
+                ok = ok && sp <= 1 && sp != 0;
+                break;
+        }
+
+        ok = ok && (sp < 0 || sp >= (long) take);
+        for(i = 1; ok && i < len; i++) ok = !depth[pc+i];
+
+        if(op == HISS_OP_JUMP || op == HISS_OP_RETURN) sp = -1;
+        else if(sp >= 0) sp += (long) push - (long) take;
+    }
+
+    free(depth);
+
+    return ok && sp < 0;
+}
+
+static int get_chunk(hiss_heap_restore* r, hiss_chunk* c){
+    const char* name;
+    uint32_t n, j;
+
+    if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) / sizeof(unsigned int) < n)
+        return 0;
+
+    c->code = (unsigned int*) malloc(sizeof(unsigned int) * (n ? n : 1));
+    memcpy(c->code, r->in.p, sizeof(unsigned int) * n);
+    c->count = c->size = n;
+    r->in.p += sizeof(unsigned int) * n;
+
+    if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) < n) return 0;
+
+    c->consts = (hiss_val**) calloc(n ? n : 1, sizeof(hiss_val*));
+    for(j = 0; j < n; j++, c->nconsts++)
+        if(!get_ref(r, &c->consts[j])) return 0;
+
+    if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) < n) return 0;
+
+    c->cells = (hiss_cell**) calloc(n ? n : 1, sizeof(hiss_cell*));
+    for(j = 0; j < n; j++, c->ncells++){
+        if(!(name = get_interned(&r->in))) return 0;
+
+        c->cells[j] = hiss_env_cell(r->e, name);
+    }
+
+    return valid_code(c);
+}
+
+static int get_object(hiss_heap_restore* r, uint32_t i){
+    hiss_val* v = (hiss_val*) r->objs[i];
+    hiss_val* x;
+    const char* key;
+    const char* s;
+    long env, code;
+    uint32_t n, j, size, len;
+    int64_t num;
+
+    switch(r->kinds[i]){
+        case IMG_ENV: return get_env(r, i);
+        case IMG_CHUNK: return get_chunk(r, (hiss_chunk*) r->objs[i]);
+        case IMG_NUM:
+            if((size_t) (r->in.end - r->in.p) < sizeof(num)) return 0;
+
+            memcpy(&num, r->in.p, sizeof(num));
+            r->in.p += sizeof(num);
+            v->num = (long) num;
+            return 1;
+        case IMG_STR:
+            if(!(v->str = get_copy(&r->in, &n))) return 0;
+
+            v->count = n;
+            return 1;
+        case IMG_SYM:
+            return (v->sym = (char*) get_interned(&r->in)) != NULL;
+        case IMG_ERR:
+            return (v->err = get_copy(&r->in, &n)) != NULL;
+        case IMG_BUF:
+            if(!(s = get_name(&r->in, &n))) return 0;
+
+            v->buf = hiss_buffer_new(n + 1);
+            hiss_buffer_append(v->buf, s, n);
+            return 1;
+        case IMG_SEXPR:
+        case IMG_QEXPR:
+        case IMG_VEC:
+            if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) < n) return 0;
+
+            hiss_cells_reserve(v, n);
+            for(j = 0; j < n; j++){
+                if(!get_ref(r, &x) || !x) return 0;
+
+                v->cells[v->count++] = x;
+            }
+            return 1;
+        case IMG_DICT:
+            if(!get_u32(&r->in, &size) || !size || size > (1u << 30)) return 0;
+            if(!get_u32(&r->in, &n) || (size_t) (r->in.end - r->in.p) < n) return 0;
+
+            v->table = hiss_table_new_copying(size);
+            for(j = 0; j < n; j++, v->count++){
+                if(!(key = get_name(&r->in, &len)) || !get_ref(r, &x) || !x ||
+                   hiss_table_get_len(v->table, key, len)) return 0;
+
+                hiss_table_put_len(v->table, key, len, x);
+            }
+            return 1;
+        case IMG_USR:
+            if(!(v->type_name = get_copy(&r->in, &n))) return 0;
+
+            return get_ref(r, &v->formals);
+        case IMG_BUILTIN:
+            return (key = get_interned(&r->in)) && (v->fun = hiss_builtin_named(key));
+        case IMG_LAMBDA:
+            if((env = get_index(r, IMG_ENV)) < 0 || !get_ref(r, &v->formals) ||
+               !get_ref(r, &v->body) || (code = get_index(r, IMG_CHUNK)) < 0) return 0;
+
+            v->env = env ? (hiss_env*) r->objs[env-1] : hiss_env_new();
+            v->code = code ? hiss_chunk_retain((hiss_chunk*) r->objs[code-1]) : NULL;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* The empty object of kind, to be filled in by get_object. */
+static void* get_shell(char kind){
+    switch(kind){
+        case IMG_ENV: return hiss_env_new();
+        case IMG_CHUNK: return hiss_chunk_retain((hiss_chunk*) calloc(1, sizeof(hiss_chunk)));
+        case IMG_NUM: return hiss_val_alloc(HISS_NUM);
+        case IMG_STR: return hiss_val_alloc(HISS_STR);
+        case IMG_SYM: return hiss_val_alloc(HISS_SYM);
+        case IMG_ERR: return hiss_val_alloc(HISS_ERR);
+        case IMG_SEXPR: return hiss_val_alloc(HISS_SEXPR);
+        case IMG_QEXPR: return hiss_val_alloc(HISS_QEXPR);
+        case IMG_VEC: return hiss_val_alloc(HISS_VEC);
+        case IMG_DICT: return hiss_val_alloc(HISS_DICT);
+        case IMG_BUF: return hiss_val_alloc(HISS_BUF);
+        case IMG_USR: return hiss_val_alloc(HISS_USR);
+        case IMG_BUILTIN:
+        case IMG_LAMBDA: return hiss_val_alloc(HISS_FUN);
+        default: return NULL;
+    }
+}
+
+int hiss_image_restore(const char* fname, hiss_env* e){
+    hiss_image_header h;
+    hiss_heap_restore r;
+    struct stat st;
+    const char* key;
+    void* map;
+    uint32_t i;
+    int ok = 0;
+    int fd = open(fname, O_RDONLY);
+
+    if(fd < 0) return 0;
+
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(h)){
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(map == MAP_FAILED) return 0;
+
+    memcpy(&h, map, sizeof(h));
+
+    r.in.p = (const char*) map + sizeof(h);
+    r.in.end = (const char*) map + st.st_size;
+    r.e = e;
+    r.objs = NULL;
+
+    if(memcmp(h.magic, HEAP_MAGIC, sizeof(h.magic)) != 0 || h.version != HEAP_VERSION ||
+       h.bom != BYTE_ORDER_MARK || h.hash != hiss_hash_bytes(r.in.p, (size_t) (r.in.end - r.in.p)) ||
+       !get_u32(&r.in, &r.n) || !r.n || (size_t) (r.in.end - r.in.p) < r.n)
+        goto done;
+
+    r.kinds = r.in.p;
+    r.in.p += r.n;
+
+    if(r.kinds[0] != IMG_ENV) goto done;
+
+    /* everything is made up front, so that objects may refer to any other */
+    r.objs = (void**) calloc(r.n, sizeof(void*));
+    r.objs[0] = e;
+    for(i = 1; i < r.n; i++)
+        if(!(r.objs[i] = get_shell(r.kinds[i]))) goto done;
+
+    for(i = 0; i < r.n; i++)
+        if(!get_object(&r, i)) goto done;
+
+    if(!get_u32(&r.in, &i)) goto done;
+
+    while(i--){
+        if(!(key = get_interned(&r.in))) goto done;
+
+        if(!hiss_table_get(hiss_modules(), key))
+            hiss_table_insert(hiss_modules(), key, hiss_val_bool(HISS_TRUE));
+    }
+
+    ok = r.in.p == r.in.end;
+
+done:
+    /* the chunks are left to the lambdas using them */
+    for(i = 1; r.objs && i < r.n && r.objs[i]; i++)
+        if(r.kinds[i] == IMG_CHUNK) hiss_chunk_release((hiss_chunk*) r.objs[i]);
+
+    free(r.objs);
+    munmap(map, (size_t) st.st_size);
+
+    return ok;
+}
+
+#else
+
+hiss_val* hiss_image_load(const char* image, size_t size, uint64_t hash){
+    return NULL;
+}
+
+int hiss_image_save(const char* image, const hiss_val* v, size_t size, uint64_t hash){
+    return 0;
+}
+
+int hiss_image_dump(const char* fname, hiss_env* e){
+    return 0;
+}
+
+int hiss_image_restore(const char* fname, hiss_env* e){
+    return 0;
+}
+
+#endif
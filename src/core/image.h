@@ -0,0 +1,62 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../utilities/util.h"
+#include "../types/environment.h"
+#include "../types/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Module images keep the expressions read from a source file, so that
+ * loading it again need not parse it. The image of foo.his is
+ * foo.hisc, next to it. An image records the size and hash of the
+ * source it was read from and is only used while they still match.
+ * The values are written out in prefix order, each one a tag byte
+ * followed by its number, its bytes or its cells; this reads back in
+ * one pass over the mapped file.
+ */
+
+/* The name of the image of the source file fname; free it. */
+char* hiss_image_name(const char* fname);
+
+/*
+ * The expressions in the image file, if it was made from a source of
+ * size bytes hashing to hash, NULL if there is no such image.
+ */
+hiss_val* hiss_image_load(const char* image, size_t size, uint64_t hash);
+
+/*
+ * Writes the expressions v, read from a source of size bytes hashing
+ * to hash, to the image file. Failing to is not an error, loading just
+ * stays slow; 0 then.
+ */
+int hiss_image_save(const char* image, const hiss_val* v, size_t size, uint64_t hash);
+
+/*
+ * Heap images keep a whole environment: its bindings and types, and the
+ * values, lambdas, environments and compiled code they reach, along
+ * with the modules loaded. Restoring one into a fresh environment with
+ * the builtins added brings it back to where it was dumped, without
+ * loading anything.
+ */
+
+/* Writes e to the heap image fname; 0 if that fails. */
+int hiss_image_dump(const char* fname, hiss_env* e);
+
+/*
+ * Restores the heap image fname into e, which should hold the builtins
+ * and not much else; 0 if there is no valid image.
+ */
+int hiss_image_restore(const char* fname, hiss_env* e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
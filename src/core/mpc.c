@@ -1,5 +1,15 @@
+#ifndef _WIN32
+/* mmap, fileno */
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "mpc.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /*
 ** State Type
 */
@@ -57,6 +67,32 @@ static mpc_err_t *mpc_err_fail(const char *filename, mpc_state_t s, const char *
   return x;
 }
 
+static mpc_err_t *mpc_err_copy(mpc_err_t *x) {
+  
+  int i;
+  mpc_err_t *y = malloc(sizeof(mpc_err_t));
+  
+  y->filename = malloc(strlen(x->filename) + 1);
+  strcpy(y->filename, x->filename);
+  y->state = x->state;
+  y->expected_num = x->expected_num;
+  y->expected = x->expected_num ? malloc(sizeof(char*) * (unsigned) x->expected_num) : NULL;
+  
+  for (i = 0; i < x->expected_num; i++) {
+    y->expected[i] = malloc(strlen(x->expected[i]) + 1);
+    strcpy(y->expected[i], x->expected[i]);
+  }
+  
+  y->failure = NULL;
+  if (x->failure) {
+    y->failure = malloc(strlen(x->failure) + 1);
+    strcpy(y->failure, x->failure);
+  }
+  
+  y->recieved = x->recieved;
+  return y;
+}
+
 void mpc_err_delete(mpc_err_t *x) {
 
   int i;
@@ -307,10 +343,18 @@ static mpc_err_t *mpc_err_count(mpc_err_t *x, int n) {
 **
 */
 
+/*
+** Files given to `mpc_parse_contents` are mapped
+** into memory where that is possible, and then
+** read like strings: every character is at hand,
+** and backtracking just moves the position back.
+*/
+
 enum {
   MPC_INPUT_STRING = 0,
   MPC_INPUT_FILE   = 1,
-  MPC_INPUT_PIPE   = 2
+  MPC_INPUT_PIPE   = 2,
+  MPC_INPUT_MMAP   = 3
 };
 
 typedef struct {
@@ -320,16 +364,20 @@ typedef struct {
   mpc_state_t state;
   
   char *string;
+  long length;
   char *buffer;
   FILE *file;
   
   int backtrack;
   int marks_num;
+  int marks_slots;
   mpc_state_t* marks;
   char* lasts;
   
   char last;
   
+  struct mpc_memo_t *memo;
+  
 } mpc_input_t;
 
 static mpc_input_t *mpc_input_new_string(const char *filename, const char *string) {
@@ -342,17 +390,20 @@ static mpc_input_t *mpc_input_new_string(const char *filename, const char *strin
   
   i->state = mpc_state_new();
   
-  i->string = malloc(strlen(string) + 1);
+  i->length = (long)strlen(string);
+  i->string = malloc((size_t)i->length + 1);
   strcpy(i->string, string);
   i->buffer = NULL;
   i->file = NULL;
   
   i->backtrack = 1;
   i->marks_num = 0;
+  i->marks_slots = 0;
   i->marks = NULL;
   i->lasts = NULL;
 
   i->last = '\0';
+  i->memo = NULL;
   
   return i;
 }
@@ -368,15 +419,18 @@ static mpc_input_t *mpc_input_new_pipe(const char *filename, FILE *pipe) {
   i->state = mpc_state_new();
   
   i->string = NULL;
+  i->length = 0;
   i->buffer = NULL;
   i->file = pipe;
   
   i->backtrack = 1;
   i->marks_num = 0;
+  i->marks_slots = 0;
   i->marks = NULL;
   i->lasts = NULL;
   
   i->last = '\0';
+  i->memo = NULL;
   
   return i;
   
@@ -392,25 +446,60 @@ static mpc_input_t *mpc_input_new_file(const char *filename, FILE *file) {
   i->state = mpc_state_new();
   
   i->string = NULL;
+  i->length = 0;
   i->buffer = NULL;
   i->file = file;
   
   i->backtrack = 1;
   i->marks_num = 0;
+  i->marks_slots = 0;
   i->marks = NULL;
   i->lasts = NULL;
   
   i->last = '\0';
+  i->memo = NULL;
   
   return i;
 }
 
+#ifndef _WIN32
+
+/* The whole of file, mapped; NULL if it cannot be, like a pipe or an empty file. */
+static mpc_input_t *mpc_input_new_mmap(const char *filename, FILE *file) {
+  
+  mpc_input_t *i;
+  struct stat st;
+  void *map;
+  
+  if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) { return NULL; }
+  
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+  if (map == MAP_FAILED) { return NULL; }
+  
+  i = mpc_input_new_file(filename, file);
+  i->type = MPC_INPUT_MMAP;
+  i->string = map;
+  i->length = (long)st.st_size;
+  i->file = NULL;
+  
+  return i;
+}
+
+#endif
+
+static void mpc_memo_delete(struct mpc_memo_t *m);
+
 static void mpc_input_delete(mpc_input_t *i) {
   
   free(i->filename);
   
+  if (i->memo) { mpc_memo_delete(i->memo); }
+  
   if (i->type == MPC_INPUT_STRING) { free(i->string); }
   if (i->type == MPC_INPUT_PIPE) { free(i->buffer); }
+#ifndef _WIN32
+  if (i->type == MPC_INPUT_MMAP) { munmap(i->string, (size_t)i->length); }
+#endif
   
   free(i->marks);
   free(i->lasts);
@@ -425,8 +514,14 @@ static void mpc_input_mark(mpc_input_t *i) {
   if (i->backtrack < 1) { return; }
   
   i->marks_num++;
-  i->marks = realloc(i->marks, sizeof(mpc_state_t) * (unsigned) i->marks_num);
-  i->lasts = realloc(i->lasts, sizeof(char) * (unsigned) i->marks_num);
+  
+  /* marks come and go with every alternative tried, the room for them stays */
+  if (i->marks_num > i->marks_slots) {
+    i->marks_slots = i->marks_slots ? i->marks_slots * 2 : 32;
+    i->marks = realloc(i->marks, sizeof(mpc_state_t) * (unsigned) i->marks_slots);
+    i->lasts = realloc(i->lasts, sizeof(char) * (unsigned) i->marks_slots);
+  }
+  
   i->marks[i->marks_num-1] = i->state;
   i->lasts[i->marks_num-1] = i->last;
   
@@ -441,8 +536,6 @@ static void mpc_input_unmark(mpc_input_t *i) {
   if (i->backtrack < 1) { return; }
   
   i->marks_num--;
-  i->marks = realloc(i->marks, sizeof(mpc_state_t) * (unsigned) i->marks_num);
-  i->lasts = realloc(i->lasts, sizeof(char) * (unsigned) i->marks_num);
   
   if (i->type == MPC_INPUT_PIPE && i->marks_num == 0) {
     free(i->buffer);
@@ -474,7 +567,7 @@ static char mpc_input_buffer_get(mpc_input_t *i) {
 }
 
 static int mpc_input_terminated(mpc_input_t *i) {
-  if (i->type == MPC_INPUT_STRING && i->state.pos == (long)strlen(i->string)) { return 1; }
+  if ((i->type == MPC_INPUT_STRING || i->type == MPC_INPUT_MMAP) && i->state.pos == i->length) { return 1; }
   if (i->type == MPC_INPUT_FILE && feof(i->file)) { return 1; }
   if (i->type == MPC_INPUT_PIPE && feof(i->file)) { return 1; }
   return 0;
@@ -486,7 +579,8 @@ static char mpc_input_getc(mpc_input_t *i) {
   
   switch (i->type) {
     
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: return i->state.pos < i->length ? i->string[i->state.pos] : '\0';
     case MPC_INPUT_FILE: c = (char) fgetc(i->file); return c;
     case MPC_INPUT_PIPE:
     
@@ -509,7 +603,8 @@ static char mpc_input_peekc(mpc_input_t *i) {
   char c = '\0';
   
   switch (i->type) {
-    case MPC_INPUT_STRING: return i->string[i->state.pos];
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: return i->state.pos < i->length ? i->string[i->state.pos] : '\0';
     case MPC_INPUT_FILE: 
       
       c = (char) fgetc(i->file);
@@ -544,7 +639,8 @@ static char mpc_input_peekc(mpc_input_t *i) {
 static int mpc_input_failure(mpc_input_t *i, char c) {
 
   switch (i->type) {
-    case MPC_INPUT_STRING: { break; }
+    case MPC_INPUT_STRING:
+    case MPC_INPUT_MMAP: { break; }
     case MPC_INPUT_FILE: fseek(i->file, -1, SEEK_CUR); { break; }
     case MPC_INPUT_PIPE: {
       
@@ -738,6 +834,7 @@ typedef struct {
   int parsers_slots;
   mpc_parser_t **parsers;
   int *states;
+  long *starts;
 
   int results_num;
   int results_slots;
@@ -755,6 +852,7 @@ static mpc_stack_t *mpc_stack_new(const char *filename) {
   s->parsers_slots = 0;
   s->parsers = NULL;
   s->states = NULL;
+  s->starts = NULL;
   
   s->results_num = 0;
   s->results_slots = 0;
@@ -786,6 +884,7 @@ static int mpc_stack_terminate(mpc_stack_t *s, mpc_result_t *r) {
   
   free(s->parsers);
   free(s->states);
+  free(s->starts);
   free(s->results);
   free(s->returns);
   free(s);
@@ -804,6 +903,7 @@ static void mpc_stack_parsers_reserve_more(mpc_stack_t *s) {
     s->parsers_slots = (int) ceil((s->parsers_slots+1) * 1.5);
     s->parsers = realloc(s->parsers, sizeof(mpc_parser_t*) * (unsigned) s->parsers_slots);
     s->states = realloc(s->states, sizeof(int) * (unsigned) s->parsers_slots);
+    s->starts = realloc(s->starts, sizeof(long) * (unsigned) s->parsers_slots);
   }
 }
 
@@ -812,14 +912,16 @@ static void mpc_stack_parsers_reserve_less(mpc_stack_t *s) {
     s->parsers_slots = (int) floor((s->parsers_slots-1) * (1.0/1.5));
     s->parsers = realloc(s->parsers, sizeof(mpc_parser_t*) * (unsigned) s->parsers_slots);
     s->states = realloc(s->states, sizeof(int) * (unsigned) s->parsers_slots);
+    s->starts = realloc(s->starts, sizeof(long) * (unsigned) s->parsers_slots);
   }
 }
 
-static void mpc_stack_pushp(mpc_stack_t *s, mpc_parser_t *p) {
+static void mpc_stack_pushp(mpc_stack_t *s, mpc_parser_t *p, long pos) {
   s->parsers_num++;
   mpc_stack_parsers_reserve_more(s);
   s->parsers[s->parsers_num-1] = p;
   s->states[s->parsers_num-1] = 0;
+  s->starts[s->parsers_num-1] = pos;
 }
 
 static void mpc_stack_popp(mpc_stack_t *s, mpc_parser_t **p, int *st) {
@@ -936,6 +1038,113 @@ static mpc_err_t *mpc_stack_merger_err(mpc_stack_t *s, int n) {
   return x;
 }
 
+/*
+** Memoization
+**
+** With memoization on, a parse remembers where
+** parsers failed: the first failure of a parser
+** at some position is kept, and trying it there
+** again fails right away with a copy of the same
+** error. Only failures that leave the input where
+** the parser started are kept, which is all of them
+** unless backtracking is off. As in packrat
+** parsing only rules are kept, that is parsers
+** with a name and those expecting something; the
+** combinators inside them rarely fail at the same
+** place twice and copying their errors costs more
+** than trying them again. Successes are not kept,
+** their results belong to whoever folds them.
+*/
+
+typedef struct {
+  mpc_parser_t *p;
+  long pos;
+  mpc_err_t *err;
+} mpc_memo_entry_t;
+
+typedef struct mpc_memo_t {
+  int num;
+  int slots;
+  mpc_memo_entry_t *entries;
+} mpc_memo_t;
+
+static mpc_memo_t *mpc_memo_new(void) {
+  mpc_memo_t *m = malloc(sizeof(mpc_memo_t));
+  m->num = 0;
+  m->slots = 1024;
+  m->entries = calloc((size_t) m->slots, sizeof(mpc_memo_entry_t));
+  return m;
+}
+
+static void mpc_memo_delete(mpc_memo_t *m) {
+  int j;
+  for (j = 0; j < m->slots; j++) {
+    if (m->entries[j].p) { mpc_err_delete(m->entries[j].err); }
+  }
+  free(m->entries);
+  free(m);
+}
+
+static mpc_memo_entry_t *mpc_memo_find(mpc_memo_t *m, mpc_parser_t *p, long pos) {
+  
+  unsigned long mask = (unsigned long) m->slots - 1;
+  unsigned long j = (((unsigned long) p >> 4) ^ ((unsigned long) pos * 0x9E3779B97F4A7C15ul)) & mask;
+  
+  while (m->entries[j].p && (m->entries[j].p != p || m->entries[j].pos != pos)) {
+    j = (j + 1) & mask;
+  }
+  
+  return &m->entries[j];
+}
+
+static void mpc_memo_grow(mpc_memo_t *m) {
+  
+  int j;
+  int slots = m->slots;
+  mpc_memo_entry_t *entries = m->entries;
+  
+  m->slots *= 2;
+  m->entries = calloc((size_t) m->slots, sizeof(mpc_memo_entry_t));
+  
+  for (j = 0; j < slots; j++) {
+    if (entries[j].p) { *mpc_memo_find(m, entries[j].p, entries[j].pos) = entries[j]; }
+  }
+  
+  free(entries);
+}
+
+static int mpc_memo_applies(mpc_input_t *i, mpc_parser_t *p) {
+  
+  if (!i->memo || i->backtrack < 1) { return 0; }
+  
+  return p->name != NULL || p->type == MPC_TYPE_EXPECT;
+}
+
+/* The failure of `p` where it is about to start, if it is known */
+static mpc_err_t *mpc_memo_get(mpc_input_t *i, mpc_parser_t *p) {
+  if (!mpc_memo_applies(i, p)) { return NULL; }
+  return mpc_memo_find(i->memo, p, i->state.pos)->err;
+}
+
+/* Keeps the failure `e` of `p`, the parser on top of the stack */
+static void mpc_memo_fail(mpc_input_t *i, mpc_stack_t *stk, mpc_parser_t *p, mpc_err_t *e) {
+  
+  mpc_memo_entry_t *entry;
+  long pos = stk->starts[stk->parsers_num-1];
+  
+  if (pos != i->state.pos || !mpc_memo_applies(i, p)) { return; }
+  
+  entry = mpc_memo_find(i->memo, p, pos);
+  if (entry->p) { return; }
+  
+  entry->p = p;
+  entry->pos = pos;
+  entry->err = mpc_err_copy(e);
+  
+  i->memo->num++;
+  if (i->memo->num * 2 > i->memo->slots) { mpc_memo_grow(i->memo); }
+}
+
 /*
 ** This is rather pleasant. The core parsing routine
 ** is written in about 200 lines of C.
@@ -957,9 +1166,9 @@ static mpc_err_t *mpc_stack_merger_err(mpc_stack_t *s, int n) {
 ** But it is now a pretty ugly beast...
 */
 
-#define MPC_CONTINUE(st, x) mpc_stack_set_state(stk, st); mpc_stack_pushp(stk, x); continue
+#define MPC_CONTINUE(st, x) mpc_stack_set_state(stk, st); mpc_stack_pushp(stk, x, i->state.pos); continue
 #define MPC_SUCCESS(x) mpc_stack_popp(stk, &p, &st); mpc_stack_pushr(stk, mpc_result_out(x), 1); continue
-#define MPC_FAILURE(x) mpc_stack_popp(stk, &p, &st); mpc_stack_pushr(stk, mpc_result_err(x), 0); continue
+#define MPC_FAILURE(x) e = (x); if (i->memo) { mpc_memo_fail(i, stk, p, e); } mpc_stack_popp(stk, &p, &st); mpc_stack_pushr(stk, mpc_result_err(e), 0); continue
 #define MPC_PRIMITIVE(x, f) if (f) { MPC_SUCCESS(x); } else { MPC_FAILURE(mpc_err_fail(i->filename, i->state, "Incorrect Input")); }
 
 int mpc_parse_input(mpc_input_t *i, mpc_parser_t *init, mpc_result_t *final) {
@@ -972,14 +1181,17 @@ int mpc_parse_input(mpc_input_t *i, mpc_parser_t *init, mpc_result_t *final) {
   /* Variables */
   char *s;
   mpc_result_t r;
+  mpc_err_t *e;
 
   /* Go! */
-  mpc_stack_pushp(stk, init);
+  mpc_stack_pushp(stk, init, i->state.pos);
   
   while (!mpc_stack_empty(stk)) {
     
     mpc_stack_peepp(stk, &p, &st);
     
+    if (st == 0 && i->memo && (e = mpc_memo_get(i, p))) { MPC_FAILURE(mpc_err_copy(e)); }
+    
     switch (p->type) {
       
       /* Basic Parsers */
@@ -1201,9 +1413,29 @@ int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result
   return x;
 }
 
+int mpc_parse_memo(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r) {
+  int x;
+  mpc_input_t *i = mpc_input_new_string(filename, string);
+  i->memo = mpc_memo_new();
+  x = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
+  return x;
+}
+
+static int mpc_parse_contents_with(const char *filename, mpc_parser_t *p, mpc_result_t *r, int memo);
+
 int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
+  return mpc_parse_contents_with(filename, p, r, 0);
+}
+
+int mpc_parse_contents_memo(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
+  return mpc_parse_contents_with(filename, p, r, 1);
+}
+
+static int mpc_parse_contents_with(const char *filename, mpc_parser_t *p, mpc_result_t *r, int memo) {
   
   FILE *f = fopen(filename, "rb");
+  mpc_input_t *i = NULL;
   int res;
   
   if (f == NULL) {
@@ -1212,7 +1444,15 @@ int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r) {
     return 0;
   }
   
-  res = mpc_parse_file(filename, f, p, r);
+#ifndef _WIN32
+  i = mpc_input_new_mmap(filename, f);
+#endif
+  
+  if (!i) { i = mpc_input_new_file(filename, f); }
+  if (memo) { i->memo = mpc_memo_new(); }
+  
+  res = mpc_parse_input(i, p, r);
+  mpc_input_delete(i);
   fclose(f);
   return res;
 }
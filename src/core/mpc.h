@@ -66,6 +66,10 @@ int mpc_parse_file(const char *filename, FILE *file, mpc_parser_t *p, mpc_result
 int mpc_parse_pipe(const char *filename, FILE *pipe, mpc_parser_t *p, mpc_result_t *r);
 int mpc_parse_contents(const char *filename, mpc_parser_t *p, mpc_result_t *r);
 
+/* As `mpc_parse` and `mpc_parse_contents`, remembering where parsers failed */
+int mpc_parse_memo(const char *filename, const char *string, mpc_parser_t *p, mpc_result_t *r);
+int mpc_parse_contents_memo(const char *filename, mpc_parser_t *p, mpc_result_t *r);
+
 /*
 ** Function Types
 */
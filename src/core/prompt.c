@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "gc.h"
+#include "image.h"
 #include "mpc.h"
+#include "reader.h"
 #include "../utilities/type_utils.h"
 
 #ifdef _WIN32
@@ -37,9 +40,18 @@ void add_history(char* unused){}
 
 #define VERSION "Hiss version 0.0.3"
 #define PROMPT "hiss> "
-#define USAGE "Usage: hiss [-hv]\n\tIf the program is called without arguments, "\
-               "the REPL is started.\n\t-h triggers this help message.\n\t"\
-               "-v triggers version information"
+#define USAGE "Usage: hiss [-hv] [--image FILE] [--dump-image FILE] [file.his]\n\t"\
+               "If the program is called without a file, the REPL is started.\n\t"\
+               "-h triggers this help message.\n\t-v triggers version information.\n\t"\
+               "--image FILE starts from the heap image FILE instead of from scratch.\n\t"\
+               "--dump-image FILE writes the heap image FILE after running the file."
+
+/* What the command line asks for. */
+typedef struct{
+    const char* file;
+    const char* image;
+    const char* dump;
+}hiss_options;
 
 static __inline int ends_with(const char* str, const char* suffix){
     size_t lenstr = strlen(str);
@@ -53,21 +65,24 @@ static __inline int ends_with(const char* str, const char* suffix){
     return strcmp(str + lenstr - lensfx, suffix) == 0;
 }
 
-static __inline char* parse_arguments(int argc, char** argv){
+static __inline void parse_arguments(int argc, char** argv, hiss_options* o){
     int i;
 
-    for(i = 1; i < argc; ){
+    for(i = 1; i < argc; i++){
         if(strcmp(argv[i], "-v") == 0){
             printf("%s\n", VERSION);
             exit(0);
-        } if(ends_with(argv[i], ".his")){
-            return argv[i];
+        } else if(strcmp(argv[i], "--image") == 0 && i + 1 < argc){
+            o->image = argv[++i];
+        } else if(strcmp(argv[i], "--dump-image") == 0 && i + 1 < argc){
+            o->dump = argv[++i];
+        } else if(!o->file && ends_with(argv[i], ".his")){
+            o->file = argv[i];
         } else {
             puts(USAGE);
             exit(127);
         }
     }
-    return NULL;
 }
 
 static __inline void print_header(){
@@ -84,7 +99,7 @@ static __inline void print_header(){
     printf("For exiting, press Ctrl-C or type :q/:quit\n\n");
 }
 
-int repl(const char* f){
+int repl(const hiss_options* o){
     mpc_result_t r;
     hiss_val* x = NULL;
     hiss_val* args = NULL;
@@ -114,15 +129,25 @@ int repl(const char* f){
     expression, hiss);
     
     e = hiss_env_new();
+    hiss_gc_add_root(e);
     hiss_env_add_builtins(e);
 
-    if(f){
-        args = hiss_val_add(hiss_val_sexpr(), hiss_val_str(f));
+    if(o->image && !hiss_image_restore(o->image, e)){
+        fprintf(stderr, "%s Could not restore image %s.\n", HISS_ERR_TOKEN, o->image);
+        exit(1);
+    }
+
+    if(o->file){
+        args = hiss_val_add(hiss_val_sexpr(), hiss_val_str(o->file));
         x = builtin_load(e, args);
 
-        if(x->type == HISS_ERR) hiss_val_println(x);
-        hiss_val_del(x);
-    }else{
+        if(HISS_TYPE(x) == HISS_ERR) hiss_val_println(x);
+    }
+
+    if(o->dump){
+        if(!hiss_image_dump(o->dump, e))
+            fprintf(stderr, "%s Could not write image %s.\n", HISS_ERR_TOKEN, o->dump);
+    }else if(!o->file){
         print_header();
         while(1){
             char* input = readline(PROMPT);
@@ -134,11 +159,15 @@ int repl(const char* f){
                 break;
             }
 
-            if(mpc_parse("stdin", input, hiss, &r)){
+            x = hiss_read(input);
+            if(x){
+                x = hiss_val_eval(e, x);
+                hiss_env_add_type(e, x);
+                hiss_val_println(x);
+            }else if(mpc_parse("stdin", input, hiss, &r)){
                 x = hiss_val_eval(e, hiss_val_read((mpc_ast_t*)r.output));
                 hiss_env_add_type(e, x);
                 hiss_val_println(x);
-                hiss_val_del(x);
             
                 mpc_ast_delete((mpc_ast_t*)r.output);
             } else {
@@ -150,7 +179,8 @@ int repl(const char* f){
         }
     }
 
-    hiss_env_del(e);
+    hiss_gc_remove_root(e);
+    hiss_gc_collect();
     
     mpc_cleanup(8, number, symbol, string, comment, s_expression, 
                 q_expression, expression, hiss);
@@ -159,8 +189,8 @@ int repl(const char* f){
 }
 
 int main(int argc, char**argv){
-    char* f = NULL;
-    if(argc > 1) f = parse_arguments(argc, argv);
+    hiss_options o = {NULL, NULL, NULL};
+    if(argc > 1) parse_arguments(argc, argv, &o);
 
-    return repl(f);
+    return repl(&o);
 }
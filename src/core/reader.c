@@ -0,0 +1,157 @@
+#include "reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../utilities/type_management.h"
+#include "../utilities/type_utils.h"
+
+/*
+ * The tokens are those of the grammar. Numbers are an optional minus
+ * and digits, and end where the digits do, even inside a run of symbol
+ * characters. Strings may hold any escape, comments run from # to the
+ * end of the line, and whitespace may follow every token. type: forms
+ * are read as the symbols mpc takes them for.
+ */
+
+static int is_space(char c){
+    return c == ' ' || c == '\f' || c == '\n' || c == '\r' || c == '\t' || c == '\v';
+}
+
+static int is_digit(char c){
+    return c >= '0' && c <= '9';
+}
+
+static int is_symbol(char c){
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || is_digit(c) ||
+           (c != '\0' && strchr("_+-*/\\=<>!|:?&", c) != NULL);
+}
+
+/* Skips the whitespace and comments at *s. */
+static void skip(const char** s){
+    while(1){
+        while(is_space(**s)) (*s)++;
+
+        if(**s != '#') return;
+
+        while(**s && **s != '\r' && **s != '\n') (*s)++;
+    }
+}
+
+/* The character the escape \c stands for, as mpcf_unescape has it. */
+static int unescape(char c, char* out){
+    switch(c){
+        case 'a': *out = '\a'; return 1;
+        case 'b': *out = '\b'; return 1;
+        case 'f': *out = '\f'; return 1;
+        case 'n': *out = '\n'; return 1;
+        case 'r': *out = '\r'; return 1;
+        case 't': *out = '\t'; return 1;
+        case 'v': *out = '\v'; return 1;
+        case '\\': *out = '\\'; return 1;
+        case '\'': *out = '\''; return 1;
+        case '"': *out = '"'; return 1;
+        case '0': *out = '\0'; return 1;
+        default: return 0;
+    }
+}
+
+/* The string starting at the quote at *s. */
+static hiss_val* read_str(const char** s){
+    const char* p = *s + 1;
+    char* str;
+    unsigned int n = 0;
+    char c;
+
+    while(*p != '"'){
+        if(!*p) return NULL;
+        if(*p == '\\' && p[1]) p++;
+        p++;
+    }
+
+    str = (char*) malloc((size_t) (p - *s));
+
+    for(p = *s + 1; *p != '"'; p++){
+        if(*p != '\\'){
+            str[n++] = *p;
+            continue;
+        }
+
+        p++;
+        if(!unescape(*p, &c)){
+            /* unknown escapes are kept as they are */
+            str[n++] = '\\';
+            str[n++] = *p;
+        }else if(c){
+            /* mpc loses \0, its strings are terminated */
+            str[n++] = c;
+        }
+    }
+
+    str[n] = '\0';
+    *s = p + 1;
+
+    return hiss_val_str_take(str, n);
+}
+
+static hiss_val* read_expr(const char** s);
+
+/* The list from the bracket at *s up to close, into v. */
+static hiss_val* read_list(const char** s, hiss_val* v, char close){
+    hiss_val* x;
+
+    (*s)++;
+    skip(s);
+
+    while(**s != close){
+        x = read_expr(s);
+        if(!x) return NULL;
+
+        v = hiss_val_add(v, x);
+    }
+
+    (*s)++;
+
+    return v;
+}
+
+static hiss_val* read_expr(const char** s){
+    const char* start = *s;
+    hiss_val* v = NULL;
+    char* end;
+
+    if(is_digit(**s) || (**s == '-' && is_digit((*s)[1]))){
+        v = hiss_val_num(strtol(start, &end, 10));
+        *s = end;
+    }else if(**s == '"'){
+        v = read_str(s);
+    }else if(is_symbol(**s)){
+        while(is_symbol(**s)) (*s)++;
+        v = hiss_val_sym_len(start, (size_t) (*s - start));
+    }else if(**s == '('){
+        v = read_list(s, hiss_val_sexpr(), ')');
+    }else if(**s == '{'){
+        v = read_list(s, hiss_val_qexpr(), '}');
+    }
+
+    if(v) skip(s);
+
+    return v;
+}
+
+hiss_val* hiss_read(const char* input){
+    const char* s = input;
+    hiss_val* v = hiss_val_sexpr();
+    hiss_val* x;
+
+    skip(&s);
+
+    while(*s){
+        x = read_expr(&s);
+        if(!x) return NULL;
+
+        v = hiss_val_add(v, x);
+    }
+
+    return v;
+}
@@ -0,0 +1,25 @@
+#ifndef READER_H
+#define READER_H
+
+#include "../utilities/util.h"
+#include "../types/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Reads all expressions of input, a terminated string, into an
+ * S-Expression, in one pass and without building a syntax tree. It
+ * accepts the same language as the mpc grammar in prompt.c and reads
+ * it into the same values as hiss_val_read would. NULL if input is not
+ * valid Hiss: the reader does not explain itself, mpc is left to parse
+ * such input again and report what is wrong with it.
+ */
+hiss_val* hiss_read(const char* input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
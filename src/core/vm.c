@@ -0,0 +1,221 @@
+#include "vm.h"
+
+#include "compiler.h"
+#include "gc.h"
+#include "../utilities/type_management.h"
+#include "../utilities/type_utils.h"
+
+#define INIT_STACK 256
+#define INIT_FRAMES 64
+
+/*
+ * A running chunk. f is the lambda the frame was entered for (NULL for
+ * frames started by hiss_vm_run), e the environment it runs in.
+ */
+typedef struct{
+    hiss_chunk* c;
+    unsigned int ip;
+    hiss_env* e;
+    hiss_val* f;
+}hiss_frame;
+
+static hiss_val** stack = NULL;
+static unsigned int sp = 0;
+static unsigned int stack_size = 0;
+
+static hiss_frame* frames = NULL;
+static unsigned int fp = 0;
+static unsigned int frames_size = 0;
+
+static void push(hiss_val* v){
+    if(sp == stack_size){
+        stack_size = stack_size ? stack_size * 2 : INIT_STACK;
+        stack = (hiss_val**) realloc(stack, sizeof(hiss_val*) * stack_size);
+    }
+
+    stack[sp++] = v;
+}
+
+static void push_frame(hiss_chunk* c, hiss_env* e, hiss_val* f){
+    if(fp == frames_size){
+        frames_size = frames_size ? frames_size * 2 : INIT_FRAMES;
+        frames = (hiss_frame*) realloc(frames, sizeof(hiss_frame) * frames_size);
+    }
+
+    frames[fp].c = c;
+    frames[fp].ip = 0;
+    frames[fp].e = e;
+    frames[fp].f = f;
+    fp++;
+}
+
+static void leave_frame(hiss_frame* fr){
+    hiss_chunk_release(fr->c);
+}
+
+/*
+ * Applies the n topmost values as an S-Expression, with the same
+ * semantics as hiss_val_eval_sexpr had on the tree. Instead of calling
+ * lambdas and 'eval' recursively, the new frame is returned through
+ * enter and left for the caller to run; in that case NULL is returned.
+ */
+static hiss_val* call(hiss_env* e, unsigned int n, hiss_frame* enter){
+    unsigned int i;
+    hiss_val** cells = &stack[sp-n];
+    hiss_val* f = NULL;
+    hiss_val* a = NULL;
+    hiss_val* x = NULL;
+
+    for(i = 0; i < n; i++){
+        if(HISS_TYPE(cells[i]) == HISS_ERR){
+            x = cells[i];
+            break;
+        }
+    }
+
+    if(x){
+        sp -= n;
+        return x;
+    }
+
+    if(n == 0) return hiss_val_sexpr();
+    if(n == 1) return stack[--sp];
+
+    f = cells[0];
+    if(HISS_TYPE(f) != HISS_FUN){
+        x = hiss_err("S-Expression starts with incorrect type. Got %s, expected %s.",
+                     hiss_type_name(HISS_TYPE(f)), hiss_type_name(HISS_FUN));
+        sp -= n;
+        return x;
+    }
+
+    if(f->fun == builtin_eval && n == 2 && HISS_TYPE(cells[1]) == HISS_QEXPR){
+        enter->c = hiss_compile_body(cells[1]);
+        enter->e = e;
+        enter->f = NULL;
+        sp -= n;
+        return NULL;
+    }
+
+    a = hiss_val_sexpr();
+    a->count = n-1;
+    hiss_cells_reserve(a, a->count);
+    memcpy(a->cells, &cells[1], sizeof(hiss_val*) * a->count);
+    sp -= n;
+
+    if(f->fun) return f->fun(e, a);
+
+    f = hiss_val_activate(f);
+    x = hiss_val_bind(e, f, a);
+    if(x) return x;
+
+    enter->c = hiss_chunk_retain(f->code);
+    enter->e = f->env;
+    enter->f = f;
+    return NULL;
+}
+
+/* The value in slot s of the environment d levels up from e, see LOCAL. */
+static const hiss_val* local(hiss_env* e, unsigned int d, unsigned int s, hiss_val* k){
+    hiss_env* l = e;
+
+    while(d-- && l) l = l->par;
+
+    if(l && s < l->n && l->slots[s].key == k->sym) return l->slots[s].value;
+
+    return hiss_env_get(e, k);
+}
+
+hiss_val* hiss_vm_run(hiss_env* e, hiss_chunk* c){
+    unsigned int base = fp;
+    unsigned int op;
+    hiss_frame* fr;
+    hiss_frame next;
+    hiss_val* f;
+    hiss_val* cond;
+    hiss_val* x;
+    const hiss_val* v;
+    unsigned int* code;
+    unsigned short b;
+
+    push_frame(hiss_chunk_retain(c), e, NULL);
+
+    while(1){
+        fr = &frames[fp-1];
+        op = fr->c->code[fr->ip++];
+
+        switch(op){
+            case HISS_OP_CONST:
+                push(fr->c->consts[fr->c->code[fr->ip++]]);
+                break;
+            case HISS_OP_LOOKUP:
+                push((hiss_val*) hiss_env_get(fr->e, fr->c->consts[fr->c->code[fr->ip++]]));
+                break;
+            case HISS_OP_LOCAL:
+                code = &fr->c->code[fr->ip];
+                fr->ip += 3;
+                push((hiss_val*) local(fr->e, code[0], code[1], fr->c->consts[code[2]]));
+                break;
+            case HISS_OP_GLOBAL:
+                code = &fr->c->code[fr->ip];
+                fr->ip += 2;
+                v = *fr->c->cells[code[0]];
+                push((hiss_val*) (v ? v : hiss_env_get(fr->e, fr->c->consts[code[1]])));
+                break;
+            case HISS_OP_CALL:
+            case HISS_OP_TAILCALL:
+                hiss_gc_poll();
+                x = call(fr->e, fr->c->code[fr->ip++], &next);
+
+                if(x){
+                    push(x);
+                }else if(op == HISS_OP_TAILCALL && fp-1 > base){
+                    /* The frame is done, the callee takes its place. */
+                    if(!next.f) next.f = fr->f;
+                    leave_frame(fr);
+                    frames[fp-1] = next;
+                    frames[fp-1].ip = 0;
+                }else{
+                    push_frame(next.c, next.e, next.f);
+                }
+                break;
+            case HISS_OP_IF:
+                f = stack[sp-2];
+                cond = stack[sp-1];
+
+                if(HISS_TYPE(f) == HISS_FUN && f->fun == builtin_if && HISS_TYPE(cond) == HISS_BOOL){
+                    b = HISS_BOOL_OF(cond);
+                    sp -= 2;
+                    fr->ip = b ? fr->ip + 2 : fr->c->code[fr->ip];
+                }else{
+                    fr->ip = fr->c->code[fr->ip+1];
+                }
+                break;
+            case HISS_OP_JUMP:
+                fr->ip = fr->c->code[fr->ip];
+                break;
+            case HISS_OP_RETURN:
+                /* The result stays on top of the stack for the caller. */
+                leave_frame(fr);
+                fp--;
+                if(fp == base) return stack[--sp];
+                break;
+            default:
+                x = hiss_err("Invalid instruction %u.", op);
+                while(fp > base) leave_frame(&frames[--fp]);
+                return x;
+        }
+    }
+}
+
+void hiss_vm_mark(){
+    unsigned int i;
+
+    for(i = 0; i < sp; i++) hiss_gc_mark(stack[i]);
+
+    for(i = 0; i < fp; i++){
+        hiss_gc_mark_chunk(frames[i].c);
+        hiss_gc_mark_env(frames[i].e);
+        hiss_gc_mark(frames[i].f);
+    }
+}
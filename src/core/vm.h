@@ -0,0 +1,30 @@
+#ifndef VM_H
+#define VM_H
+
+#include "../utilities/util.h"
+#include "../types/bytecode.h"
+#include "../types/environment.h"
+#include "../types/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runs a compiled chunk in environment e and returns the result.
+ * The chunk is not consumed. Lambdas called from the chunk run on the
+ * VM's own frame stack, and calls in tail position reuse the frame of
+ * the caller, so neither the C stack nor the environment chain grow.
+ */
+hiss_val* hiss_vm_run(hiss_env* e, hiss_chunk* c);
+
+/*
+ * Marks the values and environments in use by the VM for the collector.
+ */
+void hiss_vm_mark();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct hiss_val;
+
+/*
+ * Instruction set of the evaluator. Every instruction is one word,
+ * followed by its operands (also one word each).
+ *
+ * CONST k        push constant k
+ * LOOKUP k       push the value bound to symbol constant k
+ * LOCAL d s k    push slot s of the environment d levels up the chain,
+ *                if it still binds symbol constant k (else as LOOKUP)
+ * GLOBAL g k     push the value in global cell g, if it is bound (else
+ *                as LOOKUP k)
+ * CALL n         pop n values and apply them as an S-Expression
+ * TAILCALL n     like CALL, but in tail position: the frame of the
+ *                running lambda is reused for the callee
+ * IF else gen    inline 'if': checks that the two values on top of
+ *                the stack are the 'if' builtin and a boolean; falls
+ *                through on true, jumps to else on false and to gen
+ *                (the generic call) if the check fails
+ * JUMP to        continue at instruction to
+ * RETURN         return the value on top of the stack
+ */
+enum {HISS_OP_CONST, HISS_OP_LOOKUP, HISS_OP_LOCAL, HISS_OP_GLOBAL,
+      HISS_OP_CALL, HISS_OP_TAILCALL, HISS_OP_IF, HISS_OP_JUMP,
+      HISS_OP_RETURN};
+
+/* The value slot of a global binding, it stays put for good. */
+typedef const struct hiss_val* hiss_cell;
+
+typedef struct hiss_chunk{
+    unsigned int refs;
+    unsigned int count;
+    unsigned int size;
+    unsigned int* code;
+    unsigned int nconsts;
+    struct hiss_val** consts;
+    unsigned int ncells;
+    hiss_cell** cells;
+}hiss_chunk;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,13 +1,93 @@
 #include "environment.h"
 
+#include "../core/gc.h"
+
 hiss_env* hiss_env_new(){
   hiss_env* e = (hiss_env*) malloc(sizeof(hiss_env));
+  hiss_gc_track_env(e);
   e->par = NULL;
-  e->types = hiss_type_new();
-  e->vals = hiss_table_new();
+  e->body = NULL;
+  e->types = NULL;
+  e->vals = NULL;
+  e->n = 0;
   return e;
 }
 
+hiss_env* hiss_env_copy(hiss_env* e){
+  unsigned int i;
+  hiss_env* n = hiss_env_new();
+
+  n->par = e->par;
+  n->body = e->body;
+  if(e->types) n->types = hiss_type_copy(e->types);
+  if(e->vals) n->vals = hiss_table_copy(e->vals);
+
+  for(i = 0; i < e->n; i++) hiss_env_put_local(n, e->slots[i].key, e->slots[i].value);
+
+  return n;
+}
+
+/* Moves the slots into a hash table once they are all taken. */
+static void promote(hiss_env* e){
+  unsigned int i;
+
+  e->vals = hiss_table_new_size(HISS_ENV_SLOTS * 8);
+
+  for(i = 0; i < e->n; i++) hiss_table_insert(e->vals, e->slots[i].key, e->slots[i].value);
+
+  e->n = 0;
+}
+
+const struct hiss_val* hiss_env_get_local(hiss_env* e, const char* key){
+  unsigned int i;
+
+  if(e->vals) return hiss_table_get(e->vals, key);
+
+  for(i = 0; i < e->n; i++)
+    if(key == e->slots[i].key) return e->slots[i].value;
+
+  return NULL;
+}
+
+const struct hiss_val* hiss_env_put_local(hiss_env* e, const char* key, const struct hiss_val* value){
+  if(!e->vals && e->n == HISS_ENV_SLOTS) promote(e);
+  if(e->vals) return hiss_table_insert(e->vals, key, value);
+
+  if(!key || !value) return hiss_err("Invalid call to insert: %s", key);
+  if(hiss_env_get_local(e, key)) return hiss_err("Already defined: %s", key);
+
+  e->slots[e->n].key = key;
+  e->slots[e->n].value = value;
+  e->n++;
+
+  return hiss_val_bool(HISS_TRUE);
+}
+
+const struct hiss_val* hiss_env_remove_local(hiss_env* e, const char* key){
+  unsigned int i;
+
+  if(e->vals) return hiss_table_remove(e->vals, key);
+
+  for(i = 0; i < e->n; i++){
+    if(key == e->slots[i].key){
+      e->slots[i] = e->slots[--e->n];
+      return hiss_val_bool(HISS_TRUE);
+    }
+  }
+
+  return hiss_err("Not found: %s", key);
+}
+
+hiss_type_table* hiss_env_types(hiss_env* e){
+  if(!e->types) e->types = hiss_type_new();
+  return e->types;
+}
+
+const struct hiss_val** hiss_env_cell(hiss_env* e, const char* key){
+  if(!e->vals) promote(e);
+  return hiss_table_cell(e->vals, key);
+}
+
 void hiss_env_del(hiss_env* e){
   if(!e) return;
 
@@ -16,4 +96,3 @@ void hiss_env_del(hiss_env* e){
 
   free(e);
 }
-
@@ -6,10 +6,33 @@
 #include "../utilities/hiss_hash.h"
 #include "../utilities/hiss_type_table.h"
 
+/*
+ * Environments are collected like values (see gc.h), par is the
+ * environment the lambda was created in. The frames of a lambda keep
+ * its body, for lambdas created in them to see what the body binds with
+ * '=' later on (see compiler.c).
+ *
+ * Lambda frames only bind a handful of symbols, so an environment keeps
+ * its first HISS_ENV_SLOTS bindings in place and only moves them into a
+ * hash table (vals) once it outgrows them. types is allocated on the
+ * first type put into the environment.
+ */
+#define HISS_ENV_SLOTS 8
+
+typedef struct{
+  const char* key;
+  const struct hiss_val* value;
+}hiss_env_slot;
+
 struct hiss_env{
+  unsigned long marked;
+  struct hiss_env* next;
   struct hiss_env* par;
+  const struct hiss_val* body;
   hiss_type_table* types;
   hiss_hashtable* vals;
+  unsigned int n;
+  hiss_env_slot slots[HISS_ENV_SLOTS];
 };
 
 typedef struct hiss_env hiss_env;
@@ -19,11 +42,29 @@ typedef struct hiss_env hiss_env;
  */
 
 hiss_env* hiss_env_new();
+hiss_env* hiss_env_copy(hiss_env* e);
+
+/*
+ * Bindings of this environment only, with the semantics of the
+ * hiss_table functions; keys are interned names.
+ */
+
+const struct hiss_val* hiss_env_get_local(hiss_env* e, const char* key);
+const struct hiss_val* hiss_env_put_local(hiss_env* e, const char* key, const struct hiss_val* value);
+const struct hiss_val* hiss_env_remove_local(hiss_env* e, const char* key);
+hiss_type_table* hiss_env_types(hiss_env* e);
+
+/*
+ * The cell of key in e, made (unbound) if e has no such binding. Cells
+ * stay valid for as long as e lives.
+ */
+const struct hiss_val** hiss_env_cell(hiss_env* e, const char* key);
 
 /*
  * Destructor functions
  */
 
+/* Only the collector calls it. */
 void hiss_env_del(hiss_env* e);
 
 #endif
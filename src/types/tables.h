@@ -8,29 +8,61 @@ extern "C" {
 struct hiss_val;
 
 typedef struct hiss_type_entry{
-    unsigned short marked;
     const char* key;
     const struct hiss_val* value;
     struct hiss_type_entry* next;
 }hiss_type_entry;
 
+/*
+ * While the table grows, the buckets below moved of old have been
+ * relinked into table and the rest are still waiting in old.
+ */
 typedef struct{
     unsigned int size;
     unsigned int n;
     hiss_type_entry** table;
+    unsigned int old_size;
+    unsigned int moved;
+    hiss_type_entry** old;
 }hiss_type_table;
 
+/*
+ * cell is set once the value slot has been handed out by
+ * hiss_table_cell; such entries are unbound instead of removed. len is
+ * the length of a copied key, which may hold NUL bytes.
+ */
 typedef struct hiss_entry{
-    unsigned short marked;
     const char* key;
     const struct hiss_val* value;
-    struct hiss_entry* next;
+    unsigned int cell;
+    unsigned int len;
 }hiss_entry;
 
+/*
+ * Open addressing over groups of control bytes, one per slot: the low 7
+ * bits of the hash for a full slot, 0x80 for an empty one. The first
+ * group is mirrored behind the last one, so every group can be
+ * loaded at once. A slot whose entry was removed but which probes may
+ * have passed over stays full with no entry, a hole.
+ */
 typedef struct{
     unsigned int size;
+    unsigned char* ctrl;
+    hiss_entry** slots;
+}hiss_generation;
+
+/*
+ * While the table grows, the slots below moved of old have been
+ * migrated into cur and the rest are still waiting in old. holes counts
+ * those of cur. copying is set for tables owning copies of their keys.
+ */
+typedef struct hiss_hashtable{
     unsigned int n;
-    hiss_entry** table;
+    unsigned int holes;
+    unsigned int moved;
+    unsigned int copying;
+    hiss_generation cur;
+    hiss_generation old;
 }hiss_hashtable;
 
 #ifdef __cplusplus
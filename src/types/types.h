@@ -7,23 +7,69 @@ extern "C" {
 
 struct hiss_val;
 struct hiss_env;
+struct hiss_chunk;
+struct hiss_hashtable;
+struct hiss_buffer;
 typedef struct hiss_val hiss_val;
 typedef hiss_val*(*hiss_builtin)(struct hiss_env*, hiss_val*);
 
+/*
+ * Only the fields of the variant given by type are valid. Booleans and
+ * most numbers never get here, they are immediates (see
+ * type_management.h).
+ */
 struct hiss_val {
     unsigned short type;
-    long num;
-    unsigned short boolean;
-    char* err;
-    char* sym;
-    char* str;
-    char* type_name;
-    hiss_builtin fun;
-    struct hiss_env* env;
-    hiss_val* formals;
-    hiss_val* body;
+    unsigned short marked;
     unsigned int count;
-    struct hiss_val** cells;
+    struct hiss_val* next;
+    union {
+        long num;
+        char* err;
+        char* sym; /* interned */
+        /* user defined types keep their formals in the lambda's slot */
+        char* type_name;
+        /*
+         * S-, Q-Expressions and vectors. cells starts start cells into
+         * an allocation of size cells; taking the first cell just moves
+         * it along. A list with a base owns no cells, it is a view on
+         * some of the cells of base (see hiss_val_view). Vectors are the
+         * one kind of value that is changed in place, by the vector
+         * builtins.
+         *
+         * Strings are count bytes at str. Like lists, a string with a
+         * base owns none of them, it is a slice of base (see
+         * hiss_val_substr), and is not terminated unless it ends where
+         * base does.
+         */
+        struct {
+            unsigned int size;
+            unsigned int start;
+            union {
+                struct hiss_val** cells;
+                char* str;
+            };
+            struct hiss_val* base;
+        };
+        /*
+         * Dictionaries map their keys to {key value} pairs; count is the
+         * number of keys. They change in place, like vectors.
+         */
+        struct hiss_hashtable* table;
+        /* String buffers grow in place, for building strings piecewise. */
+        struct hiss_buffer* buf;
+        struct {
+            hiss_builtin fun;
+            struct hiss_env* env;
+            hiss_val* formals;
+            hiss_val* body;
+            struct hiss_chunk* code;
+        };
+    };
 };
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,63 @@
+#include "hiss_buffer.h"
+
+#define MIN_SIZE 16
+
+hiss_buffer* hiss_buffer_new(size_t size){
+    hiss_buffer* b = (hiss_buffer*) malloc(sizeof(hiss_buffer));
+
+    assert(b != 0);
+
+    b->size = size < MIN_SIZE ? MIN_SIZE : size + 1;
+    b->data = (char*) malloc(b->size);
+    b->len = 0;
+
+    assert(b->data != 0);
+
+    b->data[0] = '\0';
+
+    return b;
+}
+
+void hiss_buffer_delete(hiss_buffer* b){
+    if(!b) return;
+
+    free(b->data);
+    free(b);
+}
+
+void hiss_buffer_reserve(hiss_buffer* b, size_t n){
+    size_t size = b->size;
+
+    if(b->len + n < size) return;
+
+    while(b->len + n >= size) size *= 2;
+
+    b->data = (char*) realloc(b->data, size);
+    b->size = size;
+
+    assert(b->data != 0);
+}
+
+void hiss_buffer_append(hiss_buffer* b, const char* s, size_t n){
+    hiss_buffer_reserve(b, n);
+
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    b->data[b->len] = '\0';
+}
+
+char* hiss_buffer_take(hiss_buffer* b){
+    char* data = (char*) realloc(b->data, b->len + 1);
+
+    assert(data != 0);
+
+    b->size = MIN_SIZE;
+    b->data = (char*) malloc(b->size);
+    b->len = 0;
+
+    assert(b->data != 0);
+
+    b->data[0] = '\0';
+
+    return data;
+}
@@ -0,0 +1,34 @@
+#ifndef HISS_BUFFER
+#define HISS_BUFFER
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+/*
+ * A growable string. Its capacity doubles when it runs out, so that
+ * appending n bytes costs O(n) overall, however small the pieces are.
+ * data is always terminated.
+ */
+
+typedef struct hiss_buffer{
+    char* data;
+    size_t len;
+    size_t size;
+}hiss_buffer;
+
+hiss_buffer* hiss_buffer_new(size_t size);
+void hiss_buffer_delete(hiss_buffer* b);
+
+/* Makes room for n more bytes. */
+void hiss_buffer_reserve(hiss_buffer* b, size_t n);
+void hiss_buffer_append(hiss_buffer* b, const char* s, size_t n);
+
+static __inline void hiss_buffer_append_str(hiss_buffer* b, const char* s){
+    hiss_buffer_append(b, s, strlen(s));
+}
+
+/* Hands out the contents and leaves b empty; free them with free. */
+char* hiss_buffer_take(hiss_buffer* b);
+
+#endif
@@ -0,0 +1,106 @@
+#include "hiss_cells.h"
+
+#define MIN_CELLS 4
+#define CLASSES 9
+
+/* A free block keeps the next free block of its class in its first cell. */
+static hiss_val** free_cells[CLASSES];
+
+static unsigned int size_class(unsigned int size){
+    unsigned int c = 0;
+    unsigned int n = MIN_CELLS;
+
+    while(n < size){
+        n *= 2;
+        c++;
+    }
+
+    return c;
+}
+
+hiss_val** hiss_cells_alloc(unsigned int size){
+    unsigned int c = size_class(size);
+    hiss_val** cells;
+
+    if(c < CLASSES && free_cells[c]){
+        cells = free_cells[c];
+        free_cells[c] = *(hiss_val***) cells;
+        return cells;
+    }
+
+    cells = (hiss_val**) malloc(sizeof(hiss_val*) * size);
+
+    assert(cells != 0);
+
+    return cells;
+}
+
+void hiss_cells_free(hiss_val** cells, unsigned int size){
+    unsigned int c;
+
+    if(!cells) return;
+
+    c = size_class(size);
+
+    if(c >= CLASSES){
+        free(cells);
+        return;
+    }
+
+    *(hiss_val***) cells = free_cells[c];
+    free_cells[c] = cells;
+}
+
+hiss_val** hiss_cells_resize(hiss_val** cells, unsigned int size, unsigned int new_size){
+    hiss_val** n;
+
+    if(size_class(size) >= CLASSES && size_class(new_size) >= CLASSES)
+        return (hiss_val**) realloc(cells, sizeof(hiss_val*) * new_size);
+
+    n = hiss_cells_alloc(new_size);
+    if(cells){
+        memcpy(n, cells, sizeof(hiss_val*) * (size < new_size ? size : new_size));
+        hiss_cells_free(cells, size);
+    }
+
+    return n;
+}
+
+void hiss_cells_reserve(hiss_val* v, unsigned int n){
+    unsigned int size;
+    hiss_val** cells;
+
+    if(v->base){
+        size = MIN_CELLS;
+        while(size < n || size < v->count) size *= 2;
+
+        cells = hiss_cells_alloc(size);
+        memcpy(cells, v->cells, sizeof(hiss_val*) * v->count);
+
+        v->cells = cells;
+        v->size = size;
+        v->start = 0;
+        v->base = NULL;
+        return;
+    }
+
+    if(n <= v->size - v->start) return;
+
+    if(v->start){
+        memmove(v->cells - v->start, v->cells, sizeof(hiss_val*) * v->count);
+        v->cells -= v->start;
+        v->start = 0;
+
+        if(n <= v->size) return;
+    }
+
+    size = v->size ? v->size : MIN_CELLS;
+    while(size < n) size *= 2;
+
+    v->cells = hiss_cells_resize(v->cells, v->size, size);
+    v->size = size;
+}
+
+void hiss_cells_release(hiss_val* v){
+    if(v->cells && !v->base) hiss_cells_free(v->cells - v->start, v->size);
+}
@@ -0,0 +1,30 @@
+#ifndef HISS_CELLS
+#define HISS_CELLS
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../types/types.h"
+
+/*
+ * Storage for the cells of S- and Q-Expressions. Capacities are powers
+ * of two; the small ones are recycled through a free list per size
+ * class, larger ones go to malloc directly.
+ */
+
+hiss_val** hiss_cells_alloc(unsigned int size);
+hiss_val** hiss_cells_resize(hiss_val** cells, unsigned int size, unsigned int new_size);
+void hiss_cells_free(hiss_val** cells, unsigned int size);
+
+/*
+ * Makes room for at least n cells in v, moving them back to the start
+ * of their block or growing its capacity geometrically. A view gets
+ * cells of its own.
+ */
+void hiss_cells_reserve(hiss_val* v, unsigned int n);
+
+/* Frees the cells of v, wherever they start, unless v is a view. */
+void hiss_cells_release(hiss_val* v);
+
+#endif
@@ -1,16 +1,122 @@
 #include "hiss_hash.h"
-#include <limits.h>
 
 #define INIT_SIZE 65536
 #define GROWTH 2
-#define MAX_LOAD 0.99
+#define MIGRATE 16
 
-#define HASH_MUL 97
+#define EMPTY 0x80
 
-static hiss_hashtable* internal_hiss_table_new(unsigned int size){
-    hiss_hashtable* hasht = NULL;
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/* 16 control bytes are compared at once; bit i of a mask is slot i. */
+#define GROUP 16
+#define MASK_SHIFT 0
+
+typedef unsigned int hiss_mask;
+
+static __inline hiss_mask match(const unsigned char* g, unsigned char h2){
+    __m128i ctrl = _mm_loadu_si128((const __m128i*) g);
+
+    return (hiss_mask) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char) h2)));
+}
+
+static __inline hiss_mask match_empty(const unsigned char* g){
+    return (hiss_mask) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) g));
+}
+#else
+/*
+ * The portable version works on 8 control bytes in a word; bit 8i+7 of
+ * a mask is slot i. match may report a slot whose byte is h2 + 128
+ * next to a real match, which the key comparison weeds out.
+ */
+#define GROUP 8
+#define MASK_SHIFT 3
+
+#define LSBS 0x0101010101010101ull
+#define MSBS 0x8080808080808080ull
+
+typedef uint64_t hiss_mask;
+
+static __inline uint64_t load(const unsigned char* g){
+    uint64_t v = 0;
     unsigned int i;
 
+    for(i = 0; i < GROUP; i++) v |= (uint64_t) g[i] << (8 * i);
+
+    return v;
+}
+
+static __inline hiss_mask match(const unsigned char* g, unsigned char h2){
+    uint64_t x = load(g) ^ (LSBS * h2);
+
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static __inline hiss_mask match_empty(const unsigned char* g){
+    return load(g) & MSBS;
+}
+#endif
+
+static __inline unsigned int lowest(hiss_mask m){
+#ifdef __GNUC__
+    return (unsigned int) (sizeof(m) > sizeof(unsigned int) ?
+                           __builtin_ctzll(m) : __builtin_ctz((unsigned int) m)) >> MASK_SHIFT;
+#else
+    unsigned int i = 0;
+
+    while(!(m & 1)){
+        m >>= 1;
+        i++;
+    }
+
+    return i >> MASK_SHIFT;
+#endif
+}
+
+static __inline unsigned int highest(hiss_mask m){
+#ifdef __GNUC__
+    return (unsigned int) (sizeof(m) > sizeof(unsigned int) ?
+                           63 - __builtin_clzll(m) : 31 - __builtin_clz((unsigned int) m)) >> MASK_SHIFT;
+#else
+    unsigned int i = 0;
+
+    while(m >>= 1) i++;
+
+    return i >> MASK_SHIFT;
+#endif
+}
+
+static unsigned int round_size(unsigned int size){
+    unsigned int n = GROUP;
+
+    while(n < size) n *= 2;
+
+    return n;
+}
+
+static void generation_init(hiss_generation* g, unsigned int size){
+    g->size = size;
+    g->ctrl = (unsigned char*) malloc(size + GROUP);
+    g->slots = (hiss_entry**) calloc(size, sizeof(hiss_entry*));
+
+    assert(g->ctrl != 0 && g->slots != 0);
+
+    memset(g->ctrl, EMPTY, size + GROUP);
+}
+
+static void generation_free(hiss_generation* g){
+    free(g->ctrl);
+    free(g->slots);
+
+    g->size = 0;
+    g->ctrl = NULL;
+    g->slots = NULL;
+}
+
+static hiss_hashtable* internal_hiss_table_new(unsigned int size, unsigned int copying){
+    hiss_hashtable* hasht = NULL;
+
     if(size < 1) return NULL;
 
     hasht = (hiss_hashtable*) malloc(sizeof(hiss_hashtable));
@@ -18,139 +124,359 @@ static hiss_hashtable* internal_hiss_table_new(unsigned int size){
     assert(hasht != 0);
 
     hasht->n = 0;
-    hasht->size = size;
-    hasht->table = (hiss_entry**) malloc(sizeof(hiss_entry* ) * hasht->size);
-
-    for(i = 0; i < size; i++) hasht->table[i] = NULL;
+    hasht->holes = 0;
+    hasht->moved = 0;
+    hasht->copying = copying;
+    generation_init(&hasht->cur, round_size(size));
+    hasht->old.size = 0;
+    hasht->old.ctrl = NULL;
+    hasht->old.slots = NULL;
 
     return hasht;
 }
 
 hiss_hashtable* hiss_table_new(){
-    return internal_hiss_table_new(INIT_SIZE);
+    return internal_hiss_table_new(INIT_SIZE, 0);
 }
 
-hiss_hashtable* hiss_table_copy(hiss_hashtable* hasht){
-    unsigned int i;
-    hiss_hashtable* new = internal_hiss_table_new(hasht->size);
-    hiss_entry* e;
-
-    for(i = 0; i < hasht->size; i++)
-        for(e = hasht->table[i]; e != 0; e = e->next)
-            hiss_table_insert(new, e->key, e->value);
+hiss_hashtable* hiss_table_new_size(unsigned int size){
+    return internal_hiss_table_new(size, 0);
+}
 
-    return new;
+hiss_hashtable* hiss_table_new_copying(unsigned int size){
+    return internal_hiss_table_new(size, 1);
 }
 
 void hiss_table_delete(hiss_hashtable* hasht){
     unsigned int i;
-    hiss_entry* e = NULL;
-    hiss_entry* next = NULL;
 
     if(!hasht) return;
 
-    for(i = 0; i < hasht->size; i++){
-        for(e = hasht->table[i]; e != 0; e = next){
-            next = e->next;
+    /* Migrated slots of the old generation are NULL. */
+    for(i = 0; i < hasht->cur.size; i++) free(hasht->cur.slots[i]);
+    for(i = 0; i < hasht->old.size; i++) free(hasht->old.slots[i]);
 
-            free((char*)e->key);
-            free((hiss_val*)e->value);
-            free(e);
-        }
+    generation_free(&hasht->cur);
+    generation_free(&hasht->old);
+    free(hasht);
+}
+
+const hiss_entry* hiss_table_next(const hiss_hashtable* hasht, unsigned int* i){
+    const hiss_entry* e;
+
+    while(*i < hasht->cur.size + hasht->old.size){
+        if(*i < hasht->cur.size) e = hasht->cur.slots[*i];
+        else e = hasht->old.slots[*i - hasht->cur.size];
+
+        (*i)++;
+
+        if(e) return e;
     }
 
-    free(hasht->table);
-    free(hasht);
+    return NULL;
+}
+
+/*
+ * The keys of entries carry their hash in front, like interned names:
+ * copied keys are laid out as a hiss_symbol of their own.
+ */
+static uint64_t hiss_hash(const char* key){
+  assert(key != NULL);
+
+  return hiss_intern_hash(key);
 }
 
-static unsigned long hiss_hash(const char* key){
-  unsigned long hashval = 0;
-  unsigned int i = 0;
+/* The length of a terminated key, which only copied keys need. */
+static size_t key_len(const hiss_hashtable* hasht, const char* key){
+  return hasht->copying ? strlen(key) : 0;
+}
 
+/* The hash of a key being looked up. */
+static uint64_t key_hash(const hiss_hashtable* hasht, const char* key, size_t len){
   assert(key != NULL);
 
-  while(hashval < ULONG_MAX && i < strlen(key)) {
-    hashval = hashval << 8;
-    hashval += (unsigned) key[i];
-    i++;
-  }
+  return hasht->copying ? hiss_hash_bytes(key, len) : hiss_intern_hash(key);
+}
+
+/*
+ * The groups probed for a hash, in order. The steps grow by one group
+ * each time, which visits every group of a power-of-two table.
+ */
+typedef struct{
+    unsigned int pos;
+    unsigned int step;
+}hiss_probe;
 
-  return hashval;
+static __inline hiss_probe probe_start(const hiss_generation* g, uint64_t h){
+    hiss_probe p;
+
+    p.pos = (unsigned int) (h >> 7) & (g->size - 1);
+    p.step = 0;
+
+    return p;
 }
 
-static void grow(hiss_hashtable* hasht){
-    // Has to compute new hashes
-    hiss_hashtable* tmp;
-    hiss_hashtable swap;
+static __inline void probe_next(const hiss_generation* g, hiss_probe* p){
+    p->step += GROUP;
+    p->pos = (p->pos + p->step) & (g->size - 1);
+}
 
-    tmp = hiss_table_copy(hasht);
+/* Sets the control byte of slot i and its mirror behind the table. */
+static void set_ctrl(hiss_generation* g, unsigned int i, unsigned char c){
+    g->ctrl[i] = c;
+    g->ctrl[((i - GROUP) & (g->size - 1)) + GROUP] = c;
+}
+
+/* Puts e into the first empty slot on the probe sequence of h. */
+static void place(hiss_generation* g, hiss_entry* e, uint64_t h){
+    hiss_probe p = probe_start(g, h);
+    hiss_mask m;
+    unsigned int i;
 
-    /* By God, you're ugly*/
-    swap = *hasht;
-    *hasht = *tmp;
-    *tmp = swap;
+    while(!(m = match_empty(&g->ctrl[p.pos]))) probe_next(g, &p);
 
-    hiss_table_delete(tmp);
+    i = (p.pos + lowest(m)) & (g->size - 1);
+    set_ctrl(g, i, (unsigned char) (h & 0x7f));
+    g->slots[i] = e;
 }
 
-const hiss_val* hiss_table_insert(hiss_hashtable* hasht, const char* key, const hiss_val* value){
+/* The slot of key in g, or -1; copied keys are compared by contents. */
+static long slot_in(const hiss_generation* g, const char* key, size_t len, uint64_t h,
+                    unsigned int copying){
+    unsigned char h2 = (unsigned char) (h & 0x7f);
+    hiss_probe p = probe_start(g, h);
+    const unsigned char* c;
+    const hiss_entry* e;
+    unsigned int i;
+    hiss_mask m;
+
+    while(1){
+        c = &g->ctrl[p.pos];
+
+        for(m = match(c, h2); m; m &= m - 1){
+            i = (p.pos + lowest(m)) & (g->size - 1);
+            e = g->slots[i];
+            if(e && (key == e->key || (copying && e->len == len && hiss_intern_hash(e->key) == h &&
+                                       memcmp(key, e->key, len) == 0))) return (long) i;
+        }
+
+        if(match_empty(c)) return -1;
+
+        probe_next(g, &p);
+    }
+}
+
+static hiss_entry* find_in(const hiss_generation* g, const char* key, size_t len, uint64_t h,
+                           unsigned int copying){
+    long i = slot_in(g, key, len, h, copying);
+
+    return i < 0 ? NULL : g->slots[i];
+}
+
+/*
+ * Empties slot i of the current generation, if no probe can have gone
+ * past it: that takes an empty slot in every group around it, i.e. less
+ * than a group of full slots in a row through it. Otherwise the slot
+ * stays full as a hole, until the next grow leaves it behind.
+ */
+static void clear(hiss_hashtable* hasht, unsigned int i){
+    hiss_generation* g = &hasht->cur;
+    hiss_mask before = match_empty(&g->ctrl[(i - GROUP) & (g->size - 1)]);
+    hiss_mask after = match_empty(&g->ctrl[i]);
+
+    g->slots[i] = NULL;
+
+    if(before && after && lowest(after) + (GROUP - 1 - highest(before)) < GROUP)
+        set_ctrl(g, i, EMPTY);
+    else
+        hasht->holes++;
+}
+
+/*
+ * Moves the next MIGRATE slots of the old generation into the current
+ * one. Their control bytes stay full, so that probes for the entries
+ * still waiting pass over them; the slots themselves are cleared.
+ */
+static void migrate(hiss_hashtable* hasht){
     hiss_entry* e;
-    unsigned long h;
+    unsigned int end = hasht->moved + MIGRATE;
 
-    if(!hasht || !hasht->size || !key || !value) return hiss_err("Invalid call to insert: %s", key);
+    if(end > hasht->old.size) end = hasht->old.size;
 
-    h = hiss_hash(key) % hasht->size;
-    
-    for (e = hasht->table[h]; e; e = e->next) if (strcmp(key, e->key) == 0) break;
+    for(; hasht->moved < end; hasht->moved++){
+        e = hasht->old.slots[hasht->moved];
+        if(!e) continue;
 
-    if (e != NULL) return hiss_err("Already defined: %s", key);
+        place(&hasht->cur, e, hiss_hash(e->key));
+        hasht->old.slots[hasht->moved] = NULL;
+    }
 
-    e = (hiss_entry*) malloc(sizeof(hiss_entry));
+    if(hasht->moved == hasht->old.size) generation_free(&hasht->old);
+}
+
+/*
+ * Starts moving into a new generation, a bigger one unless the table
+ * is mostly holes. The entries move a few slots per insert (see
+ * migrate), so no single insert pays for the whole table; each move is
+ * long done when the next one starts. The entries themselves never move
+ * in memory, which is what makes their value slots usable as cells.
+ */
+static void grow(hiss_hashtable* hasht){
+    while(hasht->old.slots) migrate(hasht);
+
+    hasht->old = hasht->cur;
+    hasht->moved = 0;
+    hasht->holes = 0;
+    generation_init(&hasht->cur, 16 * (hasht->n + 1) > 7 * hasht->old.size ?
+                                 hasht->old.size * GROWTH : hasht->old.size);
+}
+
+static hiss_entry* find(hiss_hashtable* hasht, const char* key, size_t len){
+    uint64_t h = key_hash(hasht, key, len);
+    hiss_entry* e = find_in(&hasht->cur, key, len, h, hasht->copying);
+
+    if(!e && hasht->old.slots) e = find_in(&hasht->old, key, len, h, hasht->copying);
+
+    return e;
+}
+
+/* A copied key follows its entry, at the alignment of its hash. */
+#define KEY_OFFSET ((sizeof(hiss_entry) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t))
+
+/* Copied keys are terminated as well, for the messages naming them. */
+static hiss_entry* add(hiss_hashtable* hasht, const char* key, size_t len, const hiss_val* value){
+    uint64_t h = key_hash(hasht, key, len);
+    size_t size = hasht->copying ? KEY_OFFSET + offsetof(hiss_symbol, name) + len + 1 :
+                                   sizeof(hiss_entry);
+    hiss_entry* e = (hiss_entry*) malloc(size);
+    hiss_symbol* s;
 
     assert(e);
 
+    if(hasht->copying){
+        s = (hiss_symbol*) ((char*) e + KEY_OFFSET);
+        s->hash = h;
+        memcpy(s->name, key, len);
+        s->name[len] = '\0';
+        key = s->name;
+    }
+
     e->key = key;
     e->value = value;
+    e->cell = 0;
+    e->len = (unsigned int) len;
 
-    e->next = hasht->table[h];
-    hasht->table[h] = e;
+    if(hasht->old.slots) migrate(hasht);
 
+    /* at most 7/8 full, counting the entries still to migrate and holes */
+    if(8 * (hasht->n + hasht->holes + 1) > 7 * hasht->cur.size) grow(hasht);
+
+    place(&hasht->cur, e, h);
     hasht->n++;
 
-    if(hasht->n >= hasht->size * MAX_LOAD){ 
-        gc(hasht);
-        grow(hasht);
-    }
+    return e;
+}
+
+hiss_hashtable* hiss_table_copy(hiss_hashtable* hasht){
+    unsigned int i = 0;
+    hiss_hashtable* new = internal_hiss_table_new(hasht->cur.size, hasht->copying);
+    const hiss_entry* e;
+
+    while((e = hiss_table_next(hasht, &i)))
+        if(e->value) add(new, e->key, e->len, e->value);
+
+    return new;
+}
+
+const hiss_val* hiss_table_insert(hiss_hashtable* hasht, const char* key, const hiss_val* value){
+    hiss_entry* e;
+
+    if(!hasht || !hasht->cur.size || !key || !value) return hiss_err("Invalid call to insert: %s", key);
+
+    e = find(hasht, key, key_len(hasht, key));
+
+    if (e && e->value) return hiss_err("Already defined: %s", key);
+
+    if (e) e->value = value;
+    else add(hasht, key, key_len(hasht, key), value);
 
     return hiss_val_bool(HISS_TRUE);
 }
 
+const hiss_val* hiss_table_get_len(hiss_hashtable* hasht, const char* key, size_t len){
+    const hiss_entry* e = find(hasht, key, len);
+
+    return e ? e->value : NULL;
+}
+
 const hiss_val* hiss_table_get(hiss_hashtable* hasht, const char* key){
-    unsigned long h = hiss_hash(key) % hasht->size;
-    const hiss_entry* e;
-    
-    if (hasht->table[h] != NULL) {
-      for (e = hasht->table[h]; e; e = e->next)
-        if (strcmp(key, e->key) == 0)
-          return e->value;
+    return hiss_table_get_len(hasht, key, key_len(hasht, key));
+}
+
+const hiss_val* hiss_table_put_len(hiss_hashtable* hasht, const char* key, size_t len,
+                                   const hiss_val* value){
+    hiss_entry* e = find(hasht, key, len);
+    const hiss_val* old;
+
+    if(!e){
+        add(hasht, key, len, value);
+        return NULL;
     }
-    return NULL;
+
+    old = e->value;
+    e->value = value;
+
+    return old;
 }
 
-const hiss_val* hiss_table_remove(hiss_hashtable* hasht, const char* key){
-    unsigned long h = hiss_hash(key);
-    hiss_entry* e, *prev = NULL;
-
-    if (hasht->table[h] != NULL) { 
-      for (e = hasht->table[h]; e; e = e->next) {
-        if (strcmp(key, e->key) == 0) {
-          if (prev != NULL) prev->next = e->next;
-          else hasht->table[h] = e->next;
-          free(e);
-          return hiss_val_bool(HISS_TRUE);
-        }
-        e = prev;
-      }
+const hiss_val* hiss_table_put(hiss_hashtable* hasht, const char* key, const hiss_val* value){
+    return hiss_table_put_len(hasht, key, key_len(hasht, key), value);
+}
+
+const hiss_val** hiss_table_cell(hiss_hashtable* hasht, const char* key){
+    hiss_entry* e = find(hasht, key, key_len(hasht, key));
+
+    if(!e) e = add(hasht, key, key_len(hasht, key), NULL);
+
+    e->cell = 1;
+    return &e->value;
+}
+
+/*
+ * Entries whose cell may be in use stay behind unbound, to be bound
+ * again by the next insert of their key. All others are freed, their
+ * slot emptied where that is safe (see clear).
+ */
+const hiss_val* hiss_table_remove_len(hiss_hashtable* hasht, const char* key, size_t len){
+    uint64_t h = key_hash(hasht, key, len);
+    hiss_generation* g = &hasht->cur;
+    long i = slot_in(g, key, len, h, hasht->copying);
+    hiss_entry* e;
+
+    if(i < 0 && hasht->old.slots){
+        g = &hasht->old;
+        i = slot_in(g, key, len, h, hasht->copying);
+    }
+
+    if(i < 0 || !g->slots[i]->value) return hiss_err("Not found: %s", key);
+
+    e = g->slots[i];
+
+    if(e->cell){
+        e->value = NULL;
+        return hiss_val_bool(HISS_TRUE);
     }
-    return hiss_err("Not found: %s", key);
+
+    /* the slots of old only guide probes for what is left to migrate */
+    if(g == &hasht->cur) clear(hasht, (unsigned int) i);
+    else g->slots[i] = NULL;
+
+    free(e);
+    hasht->n--;
+
+    return hiss_val_bool(HISS_TRUE);
+}
+
+const hiss_val* hiss_table_remove(hiss_hashtable* hasht, const char* key){
+    return hiss_table_remove_len(hasht, key, key_len(hasht, key));
 }
@@ -3,19 +3,40 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
+#include "hiss_intern.h"
 #include "type_management.h"
 
-#include "../core/gc.h"
 #include "../types/tables.h"
 #include "../types/types.h"
 
+/*
+ * Keys are interned names (see hiss_intern.h), compared by address.
+ * Tables made with hiss_table_new_copying take any bytes as a key
+ * instead, compare keys by their contents and keep a copy of each key
+ * for as long as its entry lives. The functions without a len take
+ * terminated strings there.
+ */
+
 hiss_hashtable* hiss_table_new();
+hiss_hashtable* hiss_table_new_size(unsigned int size);
+hiss_hashtable* hiss_table_new_copying(unsigned int size);
 hiss_hashtable* hiss_table_copy(hiss_hashtable* e);
 const hiss_val* hiss_table_insert(hiss_hashtable* hasht, const char* key, const hiss_val* value);
 const hiss_val* hiss_table_get(hiss_hashtable* hasht, const char* key);
+/* Binds key to value, bound before or not; the value it had, or NULL. */
+const hiss_val* hiss_table_put(hiss_hashtable* hasht, const char* key, const hiss_val* value);
+const hiss_val** hiss_table_cell(hiss_hashtable* hasht, const char* key);
 const hiss_val* hiss_table_remove(hiss_hashtable* hasht, const char* key);
+const hiss_val* hiss_table_get_len(hiss_hashtable* hasht, const char* key, size_t len);
+const hiss_val* hiss_table_put_len(hiss_hashtable* hasht, const char* key, size_t len,
+                                   const hiss_val* value);
+const hiss_val* hiss_table_remove_len(hiss_hashtable* hasht, const char* key, size_t len);
 void hiss_table_delete(hiss_hashtable* hasht);
 
+/* The entry at or after *i, advancing *i past it; NULL when there is none. */
+const hiss_entry* hiss_table_next(const hiss_hashtable* hasht, unsigned int* i);
+
 #endif
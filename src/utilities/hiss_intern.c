@@ -0,0 +1,136 @@
+#include "hiss_intern.h"
+
+#define INIT_SIZE 1024
+#define GROWTH 2
+
+/* wyhash's default secret */
+#define P0 0xa0761d6478bd642full
+#define P1 0xe7037ed1a0b428dbull
+
+/* Open addressing with linear probing; symbols are never removed. */
+static hiss_symbol** table = NULL;
+static unsigned long size = 0;
+static unsigned long n = 0;
+
+/* The full 128 bit product of a and b, low half in a, high half in b. */
+static void mum(uint64_t* a, uint64_t* b){
+    uint64_t ha = *a >> 32, la = (uint32_t) *a;
+    uint64_t hb = *b >> 32, lb = (uint32_t) *b;
+    uint64_t hh = ha * hb, hl = ha * lb, lh = la * hb, ll = la * lb;
+    uint64_t t = ll + (hl << 32);
+    uint64_t c = t < ll;
+    uint64_t lo = t + (lh << 32);
+
+    c += lo < t;
+    *a = lo;
+    *b = hh + (hl >> 32) + (lh >> 32) + c;
+}
+
+static uint64_t mix(uint64_t a, uint64_t b){
+    mum(&a, &b);
+    return a ^ b;
+}
+
+static uint64_t read8(const unsigned char* p){
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint64_t read4(const unsigned char* p){
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+ * wyhash (final version 4) without the 48 byte bulk loop; names are
+ * short, and the longer inputs of hiss_hash_bytes are hashed seldom.
+ */
+static uint64_t hash(const char* key, size_t len){
+    const unsigned char* p = (const unsigned char*) key;
+    size_t i = len;
+    uint64_t seed = P0 ^ mix(P0, P1);
+    uint64_t a, b;
+
+    if(len <= 16){
+        if(len >= 4){
+            a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+        }else if(len > 0){
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        }else{
+            a = b = 0;
+        }
+    }else{
+        while(i > 16){
+            seed = mix(read8(p) ^ P1, read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    a ^= P1;
+    b ^= seed;
+    mum(&a, &b);
+
+    return mix(a ^ P0 ^ len, b ^ P1);
+}
+
+static void grow(){
+    hiss_symbol** old = table;
+    unsigned long old_size = size;
+    unsigned long i, j;
+
+    size = size ? size * GROWTH : INIT_SIZE;
+    table = (hiss_symbol**) calloc(size, sizeof(hiss_symbol*));
+
+    assert(table != 0);
+
+    for(i = 0; i < old_size; i++){
+        if(!old[i]) continue;
+
+        for(j = old[i]->hash % size; table[j]; j = (j + 1) % size);
+        table[j] = old[i];
+    }
+
+    free(old);
+}
+
+uint64_t hiss_hash_bytes(const void* p, size_t len){
+    return hash((const char*) p, len);
+}
+
+const char* hiss_intern(const char* name){
+    return hiss_intern_len(name, strlen(name));
+}
+
+const char* hiss_intern_len(const char* name, size_t len){
+    uint64_t h = hash(name, len);
+    unsigned long i;
+    hiss_symbol* s;
+
+    /* at most half full */
+    if(2 * (n + 1) > size) grow();
+
+    for(i = h % size; table[i]; i = (i + 1) % size)
+        if(table[i]->hash == h && strncmp(table[i]->name, name, len) == 0 && !table[i]->name[len])
+            return table[i]->name;
+
+    s = (hiss_symbol*) malloc(sizeof(hiss_symbol) + len + 1);
+
+    assert(s != 0);
+
+    s->hash = h;
+    memcpy(s->name, name, len);
+    s->name[len] = '\0';
+
+    table[i] = s;
+    n++;
+
+    return s->name;
+}
@@ -0,0 +1,34 @@
+#ifndef HISS_INTERN
+#define HISS_INTERN
+
+#include <stdlib.h>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Symbol names are interned: every distinct name exists once for the
+ * whole process, so interned names compare by pointer. Their hash, a
+ * 64 bit wyhash-style mix of all bytes, is computed once, when they are
+ * interned.
+ */
+
+typedef struct{
+    uint64_t hash;
+    char name[];
+}hiss_symbol;
+
+const char* hiss_intern(const char* name);
+/* Interns the first len bytes of name, which need not be terminated. */
+const char* hiss_intern_len(const char* name, size_t len);
+
+/* The same hash for any len bytes. */
+uint64_t hiss_hash_bytes(const void* p, size_t len);
+
+/* The hash of an interned name. */
+static __inline uint64_t hiss_intern_hash(const char* name){
+    return ((const hiss_symbol*) (name - offsetof(hiss_symbol, name)))->hash;
+}
+
+#endif
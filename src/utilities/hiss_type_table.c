@@ -2,13 +2,13 @@
 
 #define INIT_SIZE 1024
 #define GROWTH 2
+#define MIGRATE 8
 #define MAX_LOAD 1
 
 #define HASH_MUL 97
 
 static hiss_type_table* internal_hiss_type_new(unsigned int size){
     hiss_type_table* hasht = NULL;
-    unsigned int i;
 
     if(size < 1) return NULL;
 
@@ -16,10 +16,14 @@ static hiss_type_table* internal_hiss_type_new(unsigned int size){
 
     assert(hasht != 0);
 
+    hasht->n = 0;
     hasht->size = size;
-    hasht->table = (hiss_type_entry**) malloc(sizeof(hiss_type_entry* ) * hasht->size);
+    hasht->table = (hiss_type_entry**) calloc(size, sizeof(hiss_type_entry*));
+    hasht->old_size = 0;
+    hasht->moved = 0;
+    hasht->old = NULL;
 
-    for(i = 0; i < size; i++) hasht->table[i] = NULL;
+    assert(hasht->table != 0);
 
     return hasht;
 }
@@ -28,33 +32,45 @@ hiss_type_table* hiss_type_new(){
     return internal_hiss_type_new(INIT_SIZE);
 }
 
-hiss_type_table* hiss_type_copy(hiss_type_table* hasht){
+static void copy_chains(hiss_type_table* new, hiss_type_entry** table, unsigned int size){
     unsigned int i;
-    hiss_type_table* new = internal_hiss_type_new(hasht->size);
     hiss_type_entry* e;
 
-    for(i = 0; i < hasht->size; i++)
-        for(e = hasht->table[i]; e != 0; e = e->next)
+    for(i = 0; i < size; i++)
+        for(e = table[i]; e != 0; e = e->next)
             hiss_type_insert(new, e->key, e->value);
+}
+
+hiss_type_table* hiss_type_copy(hiss_type_table* hasht){
+    hiss_type_table* new = internal_hiss_type_new(hasht->size);
+
+    copy_chains(new, hasht->table, hasht->size);
+    copy_chains(new, hasht->old, hasht->old_size);
 
     return new;
 }
 
-void hiss_type_delete(hiss_type_table* hasht){
+static void free_chains(hiss_type_entry** table, unsigned int size){
     unsigned int i;
     hiss_type_entry* e = NULL;
+    hiss_type_entry* next = NULL;
 
-    if(hasht == NULL) return;
-
-    for(i = 0; i < hasht->size; i++){
-        for(e = hasht->table[i]; e != 0; e = e->next){
-            free((char*)e->key);
-            free((struct hiss_val*)e->value);
+    for(i = 0; i < size; i++){
+        for(e = table[i]; e != 0; e = next){
+            next = e->next;
             free(e);
         }
     }
 
-    free(hasht->table);
+    free(table);
+}
+
+void hiss_type_delete(hiss_type_table* hasht){
+    if(hasht == NULL) return;
+
+    /* Keys are the names of the types, which own them. */
+    free_chains(hasht->table, hasht->size);
+    free_chains(hasht->old, hasht->old_size);
     free(hasht);
 }
 
@@ -68,18 +84,53 @@ static unsigned long hiss_hash(const char* key){
     return h;
 }
 
+/*
+ * Relinks the next MIGRATE buckets of the old generation. Their entries
+ * are older than any in the current one, so they go to the ends of the
+ * chains, where they would have been all along.
+ */
+static void migrate(hiss_type_table* hasht){
+    hiss_type_entry* e;
+    hiss_type_entry* next;
+    hiss_type_entry** tail;
+    unsigned int end = hasht->moved + MIGRATE;
+
+    if(end > hasht->old_size) end = hasht->old_size;
+
+    for(; hasht->moved < end; hasht->moved++){
+        for(e = hasht->old[hasht->moved]; e != 0; e = next){
+            next = e->next;
+            tail = &(hasht->table[hiss_hash(e->key) % hasht->size]);
+            while(*tail) tail = &((*tail)->next);
+            e->next = NULL;
+            *tail = e;
+        }
+
+        hasht->old[hasht->moved] = NULL;
+    }
+
+    if(hasht->moved == hasht->old_size){
+        free(hasht->old);
+        hasht->old = NULL;
+        hasht->old_size = 0;
+    }
+}
+
+/*
+ * Starts moving the entries into twice as many buckets. They move a
+ * few buckets per insert, so no single insert pays for the whole table.
+ */
 static void grow(hiss_type_table* hasht){
-    hiss_type_table* tmp;
-    hiss_type_table swap;
+    while(hasht->old) migrate(hasht);
 
-    tmp = hiss_type_copy(hasht);
+    hasht->old = hasht->table;
+    hasht->old_size = hasht->size;
+    hasht->moved = 0;
 
-    /* By God, you're ugly */
-    swap = *hasht;
-    *hasht = *tmp;
-    *tmp = swap;
+    hasht->size *= GROWTH;
+    hasht->table = (hiss_type_entry**) calloc(hasht->size, sizeof(hiss_type_entry*));
 
-    hiss_type_delete(tmp);
+    assert(hasht->table != 0);
 }
 
 void hiss_type_insert(hiss_type_table* hasht, const char* key, const struct hiss_val* value){
@@ -96,39 +147,50 @@ void hiss_type_insert(hiss_type_table* hasht, const char* key, const struct hiss
     e->key = key;
     e->value = value;
 
+    if(hasht->old) migrate(hasht);
+
+    if(hasht->n + 1 > hasht->size * MAX_LOAD) grow(hasht);
+
     h = hiss_hash(key) % hasht->size;
 
     e->next = hasht->table[h];
     hasht->table[h] = e;
 
     hasht->n++;
+}
+
+static hiss_type_entry** find(hiss_type_table* hasht, const char* key){
+    hiss_type_entry** prev;
+    unsigned long h = hiss_hash(key);
 
-    if(hasht->n >= hasht->size * MAX_LOAD) grow(hasht);
+    for(prev = &(hasht->table[h % hasht->size]); *prev; prev = &((*prev)->next))
+        if((*prev)->key == key) return prev;
+
+    if(!hasht->old) return NULL;
+
+    for(prev = &(hasht->old[h % hasht->old_size]); *prev; prev = &((*prev)->next))
+        if((*prev)->key == key) return prev;
+
+    return NULL;
 }
 
 const struct hiss_val* hiss_type_get(hiss_type_table* hasht, const char* key){
-    hiss_type_entry* e;
+    hiss_type_entry** e = find(hasht, key);
 
-    for(e = hasht->table[hiss_hash(key) % hasht->size]; e; e = e->next)
-        if(e->key == key) return e->value;
+    if(e) return (*e)->value;
 
     return hiss_err("Not found: %s", key);
 }
 
 void hiss_type_remove(hiss_type_table* hasht, const char* key){
-    hiss_type_entry** prev;
+    hiss_type_entry** prev = find(hasht, key);
     hiss_type_entry* e;
 
-    for(prev = &(hasht->table[hiss_hash(key) % hasht->size]); *prev; prev = &((*prev)->next)){
-        if((*prev)->key == key){
-            e = *prev;
-            *prev = e->next;
+    if(!prev) return;
 
-            free(e);
-            hiss_val_del((hiss_val*)e->value);
-            free(e);
+    e = *prev;
+    *prev = e->next;
+    hasht->n--;
 
-            return;
-        }
-    }
+    free(e);
 }
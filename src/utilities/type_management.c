@@ -1,62 +1,151 @@
 #include "type_management.h"
+#include "hiss_cells.h"
+#include "hiss_hash.h"
+
+#include "../core/compiler.h"
+#include "../core/gc.h"
+
+hiss_val* hiss_val_alloc(unsigned short type){
+    hiss_val* val = hiss_gc_alloc();
+    val->type = type;
+    return val;
+}
 
 hiss_val* hiss_val_num(long n){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-    val->type = HISS_NUM;
+    hiss_val* val;
+
+    if(n >= HISS_IMM_MIN && n <= HISS_IMM_MAX)
+        return (hiss_val*) (((uintptr_t) n << 2) | HISS_IMM_NUM);
+
+    val = hiss_val_alloc(HISS_NUM);
     val->num = n;
     return val;
 }
 
 hiss_val* hiss_val_bool(unsigned short boolean){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-    val->type = HISS_BOOL;
-    val->boolean = boolean;
-    return val;
+    return (hiss_val*) (((uintptr_t) (boolean != 0) << 2) | HISS_IMM_BOOL);
 }
 
 hiss_val* hiss_val_sym(const char* s){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-    val->type = HISS_SYM;
-    val->sym = (char*) malloc(strlen(s) + 1);
-    strcpy(val->sym, s);
+    return hiss_val_sym_len(s, strlen(s));
+}
+
+hiss_val* hiss_val_sym_len(const char* s, size_t n){
+    hiss_val* val = hiss_val_alloc(HISS_SYM);
+    val->sym = (char*) hiss_intern_len(s, n);
     return val;
 }
 
 hiss_val* hiss_val_str(const char* s){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-    val->type = HISS_STR;
-    val->str = (char*) malloc(strlen(s) + 1);
-    strcpy(val->str, s);
+    return hiss_val_str_len(s, (unsigned int) strlen(s));
+}
+
+hiss_val* hiss_val_str_len(const char* s, unsigned int n){
+    hiss_val* val = hiss_val_alloc(HISS_STR);
+    val->count = n;
+    val->str = (char*) malloc(n + 1);
+    memcpy(val->str, s, n);
+    val->str[n] = '\0';
+    return val;
+}
+
+hiss_val* hiss_val_str_take(char* s, unsigned int n){
+    hiss_val* val = hiss_val_alloc(HISS_STR);
+    val->count = n;
+    val->str = s;
     return val;
 }
 
 hiss_val* hiss_val_fun(hiss_builtin fun) {
-  hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-  val->type = HISS_FUN;
+  hiss_val* val = hiss_val_alloc(HISS_FUN);
   val->fun = fun;
   return val;
 }
 
 hiss_val* hiss_val_sexpr(){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
-    val->type = HISS_SEXPR;
-    val->type = HISS_SEXPR;
+    hiss_val* val = hiss_val_alloc(HISS_SEXPR);
     val->count = 0;
     val->cells = NULL;
     return val;
 }
 
 hiss_val* hiss_val_qexpr(){
-  hiss_val* v = (hiss_val*) malloc(sizeof(hiss_val));
-  v->type = HISS_QEXPR;
+  hiss_val* v = hiss_val_alloc(HISS_QEXPR);
+  v->count = 0;
+  v->cells = NULL;
+  return v;
+}
+
+/*
+ * A Q-Expression of the n cells of v from from on, sharing them with v
+ * instead of copying them. Lists never change once they are shared, so
+ * neither notices the other.
+ */
+hiss_val* hiss_val_view(hiss_val* v, unsigned int from, unsigned int n){
+  hiss_val* view = hiss_val_qexpr();
+
+  if(!n) return view;
+
+  view->count = n;
+  view->cells = &v->cells[from];
+  view->base = v->base ? v->base : v;
+
+  return view;
+}
+
+/*
+ * A string of the n bytes of v from from on, sharing them like
+ * hiss_val_view shares cells.
+ */
+hiss_val* hiss_val_substr(hiss_val* v, unsigned int from, unsigned int n){
+  hiss_val* s = hiss_val_alloc(HISS_STR);
+
+  s->count = n;
+  s->str = &v->str[from];
+  s->base = v->base ? v->base : v;
+
+  return s;
+}
+
+const char* hiss_val_cstr(hiss_val* v){
+  char* str;
+
+  /* a slice can always look at the byte after it, inside its base */
+  if(v->str[v->count] == '\0') return v->str;
+
+  str = (char*) malloc(v->count + 1);
+  memcpy(str, v->str, v->count);
+  str[v->count] = '\0';
+
+  v->str = str;
+  v->base = NULL;
+
+  return str;
+}
+
+hiss_val* hiss_val_dict(unsigned int size){
+  hiss_val* v = hiss_val_alloc(HISS_DICT);
+  v->count = 0;
+  /* the table is never empty, it rounds up to a group */
+  v->table = hiss_table_new_copying(size ? size : 1);
+  return v;
+}
+
+hiss_val* hiss_val_buf(size_t size){
+  hiss_val* v = hiss_val_alloc(HISS_BUF);
+  v->buf = hiss_buffer_new(size);
+  return v;
+}
+
+hiss_val* hiss_val_vec(){
+  hiss_val* v = hiss_val_alloc(HISS_VEC);
   v->count = 0;
   v->cells = NULL;
   return v;
 }
 
 hiss_val* hiss_val_type(char* type, hiss_val* formals){
-  hiss_val* v = (hiss_val*) malloc(sizeof(hiss_val));
-  v->type = HISS_USR;
+  hiss_val* v = hiss_val_alloc(HISS_USR);
   v->type_name = type;
   v->formals = formals;
   v->count = 0;
@@ -64,20 +153,19 @@ hiss_val* hiss_val_type(char* type, hiss_val* formals){
 }
 
 hiss_val* hiss_val_lambda(hiss_val* formals, hiss_val* body){
-  hiss_val* v = (hiss_val*) malloc(sizeof(hiss_val));
-  v->type = HISS_FUN;
+  hiss_val* v = hiss_val_alloc(HISS_FUN);
   v->fun = NULL;
   v->env = hiss_env_new();
   v->formals = formals;
   v->body = body;
+  v->code = NULL;
   return v;  
 }
 
 hiss_val* hiss_err(const char* fmt, ...){
-    hiss_val* val = (hiss_val*) malloc(sizeof(hiss_val));
+    hiss_val* val = hiss_val_alloc(HISS_ERR);
     va_list va;
     va_start(va, fmt);
-    val->type = HISS_ERR;
     val->err = (char*) malloc(512);
 
     vsnprintf(val->err, 511, fmt, va);
@@ -88,32 +176,20 @@ hiss_val* hiss_err(const char* fmt, ...){
 }
 
 void hiss_val_del(hiss_val* val){
-    unsigned int i;
     switch(val->type){
-        case HISS_BOOL:
         case HISS_NUM: break;
-        case HISS_STR: free(val->str); break;
-        case HISS_USR: 
-            free(val->type_name); 
-            hiss_val_del(val->formals);
-            break;
+        case HISS_STR: if(!val->base) free(val->str); break;
+        case HISS_USR: free(val->type_name); break;
         case HISS_ERR: free(val->err); break;
-        case HISS_SYM: free(val->sym); break;
         case HISS_QEXPR:
-        case HISS_SEXPR:
-            for(i = 0; i < val->count; i++)
-                hiss_val_del(val->cells[i]);
-            free(val->cells);
-            break;
+        case HISS_VEC:
+        case HISS_SEXPR: hiss_cells_release(val); break;
+        case HISS_DICT: hiss_table_delete(val->table); break;
+        case HISS_BUF: hiss_buffer_delete(val->buf); break;
         case HISS_FUN:
-            if(!val->fun){
-                hiss_env_del(val->env);
-                hiss_val_del(val->formals);
-                hiss_val_del(val->body);
-            }
+            if(!val->fun) hiss_chunk_release(val->code);
             break;
         default: break;
     }
-    free(val);
 }
 
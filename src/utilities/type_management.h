@@ -1,34 +1,72 @@
 #ifndef TYPE_MANAGEMENT_H
 #define TYPE_MANAGEMENT_H
 
+#include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
 
 #include "../types/environment.h"
 #include "../types/tables.h"
 #include "../types/types.h"
 
+#include "hiss_buffer.h"
+#include "hiss_intern.h"
 #include "util.h"
 
+/*
+ * Booleans and numbers that fit into 62 bits are not allocated, they are
+ * encoded in the hiss_val pointer itself: a set low bit marks an
+ * immediate and the second bit tells booleans from numbers. Use these
+ * instead of ->type, ->num and ->boolean wherever a value may be one.
+ */
+
+#define HISS_IMM_NUM 1
+#define HISS_IMM_BOOL 3
+#define HISS_IMM_MAX (LONG_MAX >> 2)
+#define HISS_IMM_MIN (-HISS_IMM_MAX - 1)
+
+#define HISS_IS_IMM(v) (((uintptr_t) (v)) & 1)
+#define HISS_TYPE(v) (HISS_IS_IMM(v) ? \
+    ((((uintptr_t) (v)) & 2) ? HISS_BOOL : HISS_NUM) : (v)->type)
+#define HISS_NUM_OF(v) (HISS_IS_IMM(v) ? (long) (((intptr_t) (v)) >> 2) : (v)->num)
+#define HISS_BOOL_OF(v) ((unsigned short) (((uintptr_t) (v)) >> 2))
+
 
 /*
  * Constructor functions
  */
 
+hiss_val* hiss_val_alloc(unsigned short type);
 hiss_val* hiss_val_num(long n);
 hiss_val* hiss_val_bool(unsigned short n);
 hiss_val* hiss_val_sym(const char* s);
+hiss_val* hiss_val_sym_len(const char* s, size_t n);
 hiss_val* hiss_val_str(const char* s);
+hiss_val* hiss_val_str_len(const char* s, unsigned int n);
+/* A string of the n bytes at s itself, which must come from malloc. */
+hiss_val* hiss_val_str_take(char* s, unsigned int n);
 hiss_val* hiss_val_fun(hiss_builtin fun);
 hiss_val* hiss_val_lambda(hiss_val* formals, hiss_val* body);
 hiss_val* hiss_val_type(char* type, hiss_val* formals);
 hiss_val* hiss_val_sexpr();
 hiss_val* hiss_val_qexpr();
+hiss_val* hiss_val_vec();
+hiss_val* hiss_val_dict(unsigned int size);
+hiss_val* hiss_val_buf(size_t size);
+hiss_val* hiss_val_view(hiss_val* v, unsigned int from, unsigned int n);
+hiss_val* hiss_val_substr(hiss_val* v, unsigned int from, unsigned int n);
+/* The bytes of the string v, terminated; v may get bytes of its own. */
+const char* hiss_val_cstr(hiss_val* v);
 hiss_val* hiss_err(const char* fmt, ...);
 
 /*
  * Destructor functions
  */
 
+/*
+ * Frees what val owns besides other values; only the collector calls it,
+ * the node itself goes back to the collector's free list.
+ */
 void hiss_val_del(hiss_val* val);
 
 #endif
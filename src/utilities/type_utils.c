@@ -1,13 +1,24 @@
+#ifndef _WIN32
+/* realpath */
+#define _XOPEN_SOURCE 700
+#endif
+
 #include "type_utils.h"
 
+#include "../core/compiler.h"
+#include "../core/gc.h"
+#include "../core/image.h"
+#include "../core/reader.h"
+#include "../core/vm.h"
+
 #define HISS_ASSERT(args, cond, fmt, ...) \
-  if (!(cond)) { hiss_val* err = hiss_err(fmt, __VA_ARGS__); hiss_val_del(args); return err;}
+  if (!(cond)) { return hiss_err(fmt, __VA_ARGS__); }
 
 #define HISS_ASSERT_TYPE(fun, args, index, expect) \
-  HISS_ASSERT(args, args->cells[index]->type == expect, \
+  HISS_ASSERT(args, HISS_TYPE(args->cells[index]) == expect, \
     "Function '%s' passed incorrect type for argument %i. " \
     "Got %s, expected %s.", \
-    fun, index, hiss_type_name(args->cells[index]->type), hiss_type_name(expect))
+    fun, index, hiss_type_name(HISS_TYPE(args->cells[index])), hiss_type_name(expect))
 
 #define HISS_ASSERT_NUM(fun, args, num) \
   HISS_ASSERT(args, args->count == num, \
@@ -20,29 +31,29 @@
     "Function '%s' passed {} for argument %i.", fun, index);
 
 #define HISS_ASSERT_MIN_STRLEN(fun, args, index, len) \
-  HISS_ASSERT(args, strlen(args->cells[index]->str) >= len, \
+  HISS_ASSERT(args, args->cells[index]->count >= len, \
     "Function '%s' expected string of minimum length %d for argument %i.", fun, len, index);
 
-static hiss_val* hiss_val_call(hiss_env* e, hiss_val* f, hiss_val* a);
-static const char* hiss_type_name(int t);
-
 hiss_val* hiss_val_add(hiss_val* v, hiss_val* a){
-    v->count++;
-    v->cells = (hiss_val**) realloc(v->cells, sizeof(hiss_val*) * v->count);
-    v->cells[v->count-1] = a;
+    hiss_cells_reserve(v, v->count+1);
+    v->cells[v->count++] = a;
     return v;
 }
 
-hiss_env* hiss_env_copy(hiss_env* e){
-    hiss_env* n = (hiss_env*) malloc(sizeof(hiss_env));
-    n->par = e->par;
-    n->vals = hiss_table_copy(e->vals);
-    n->types = hiss_type_copy(e->types);
-    return n;
-}
+/*
+ * How many reloads are running (see builtin_reload); the definitions
+ * made during one replace those of the module's last load.
+ */
+static unsigned int reloading = 0;
 
 static const hiss_val* hiss_env_def(hiss_env* e, hiss_val* k, hiss_val* v){
     while(e->par) e = e->par;
+
+    if(reloading){
+        *hiss_env_cell(e, k->sym) = v;
+        return hiss_val_bool(HISS_TRUE);
+    }
+
     return hiss_env_put(e, k, v);
 }
 
@@ -58,6 +69,9 @@ static hiss_val* hiss_val_read_expr(mpc_ast_t* t){
     if(strstr(t->tag, "qexpr")) v = hiss_val_qexpr();
     if(strcmp(t->tag, ">") == 0 || strstr(t->tag, "sexpr")) v = hiss_val_sexpr();
 
+    /* all children but the brackets, in one block */
+    if(v && t->children_num > 0) hiss_cells_reserve(v, (unsigned int) t->children_num);
+
     for(i = 0; i < t->children_num; i++){
         if(strcmp(t->children[i]->contents, "(") == 0) continue;
         else if(strcmp(t->children[i]->contents, ")") == 0) continue;
@@ -82,7 +96,6 @@ static hiss_val* hiss_val_read_type(mpc_ast_t* t){
     unescaped = (char*) mpcf_unescape((mpc_val_t*)unescaped);
     type = hiss_val_type(unescaped, hiss_val_read_expr(t));
 
-    free(unescaped);
     return type;
 }
 
@@ -121,9 +134,9 @@ static void hiss_val_expr_print(hiss_val* v, const char open, const char close){
     putchar(close);
 }
 
-static void hiss_val_print_str(hiss_val* v){
-    char* escaped = (char*) malloc(strlen(v->str)+1);
-    strcpy(escaped, v->str);
+static void hiss_val_print_str(const char* s){
+    char* escaped = (char*) malloc(strlen(s)+1);
+    strcpy(escaped, s);
 
     escaped = (char*) mpcf_escape((mpc_val_t*)escaped);
     printf("\"%s\"", escaped);
@@ -131,15 +144,41 @@ static void hiss_val_print_str(hiss_val* v){
     free(escaped);
 }
 
+static void hiss_val_dict_print(hiss_val* v){
+    unsigned int i = 0;
+    unsigned int n = 0;
+    const hiss_entry* entry;
+
+    printf("#{");
+
+    while((entry = hiss_table_next(v->table, &i))){
+        if(!entry->value) continue;
+
+        if(n++) putchar(' ');
+        hiss_val_print(entry->value->cells[0]);
+        putchar(' ');
+        hiss_val_print(entry->value->cells[1]);
+    }
+
+    putchar('}');
+}
+
 void hiss_val_print(hiss_val* val){
-    switch(val->type){
-        case HISS_NUM: printf("%li", val->num); break;
-        case HISS_STR: hiss_val_print_str(val); break;
-        case HISS_BOOL: val->boolean == HISS_TRUE ? printf("true") : printf("false"); break;
+    switch(HISS_TYPE(val)){
+        case HISS_NUM: printf("%li", HISS_NUM_OF(val)); break;
+        case HISS_STR: hiss_val_print_str(hiss_val_cstr(val)); break;
+        case HISS_BOOL: HISS_BOOL_OF(val) == HISS_TRUE ? printf("true") : printf("false"); break;
         case HISS_ERR: printf("%s Error: %s", HISS_ERR_TOKEN, val->err); break;
         case HISS_SYM: printf("%s", val->sym); break;
         case HISS_SEXPR: hiss_val_expr_print(val, '(', ')'); break;
         case HISS_QEXPR: hiss_val_expr_print(val, '{', '}'); break;
+        case HISS_VEC: hiss_val_expr_print(val, '[', ']'); break;
+        case HISS_DICT: hiss_val_dict_print(val); break;
+        case HISS_BUF:
+          printf("<buffer ");
+          hiss_val_print_str(val->buf->data);
+          putchar('>');
+          break;
         case HISS_USR: 
             printf("<type %s: ", val->type_name);
             hiss_val_print(val->formals);
@@ -165,15 +204,33 @@ void hiss_val_println(hiss_val* val){
     putchar('\n');
 }
 
+hiss_val* hiss_val_shift(hiss_val* val){
+  hiss_val* x = val->cells[0];
+
+  val->cells++;
+  val->start++;
+  val->count--;
+
+  if(!val->count){
+    val->cells -= val->start;
+    val->start = 0;
+  }
+
+  return x;
+}
+
 hiss_val* hiss_val_pop(hiss_val* val, unsigned int i){
-  hiss_val* x = val->cells[i];
+  hiss_val* x;
+
+  if(i == 0) return hiss_val_shift(val);
+
+  x = val->cells[i];
 
   memmove(&val->cells[i], &val->cells[i+1],
           sizeof(hiss_val*) * (val->count-i-1));
 
   val->count--;
 
-  val->cells = (hiss_val**) realloc(val->cells, sizeof(hiss_val*) * val->count);
   return x;
 }
 
@@ -182,175 +239,171 @@ hiss_val* hiss_val_take(hiss_val* val, unsigned int i){
   return x;
 }
 
-static hiss_val* builtin_op(hiss_env*e, hiss_val* a, const char* op){
+/* NULL if the arguments of fun are one or more numbers, an error otherwise. */
+static hiss_val* check_nums(const char* fun, hiss_val* a){
   unsigned int i;
-  hiss_val* x = NULL;
-  hiss_val* y = NULL;
+
+  HISS_ASSERT(a, a->count > 0,
+    "Function '%s' passed incorrect number of arguments. "
+    "Got %i, expected at least %i.", fun, a->count, 1);
+
   for(i = 0; i < a->count; i++){
-    if (a->cells[i]->type != HISS_NUM) {
-      hiss_val_del(a);
+    if (HISS_TYPE(a->cells[i]) != HISS_NUM) {
       return hiss_err("Cannot operate on non-number!");
     }
   }
-  
-  x = hiss_val_pop(a, 0);
-  
-  if((strcmp(op, "-") == 0) && a->count == 0) x->num = -x->num;
-  
-  while (a->count > 0){
-    y = hiss_val_pop(a, 0);
-    
-    if(strcmp(op, "+") == 0) x->num += y->num;
-    else if(strcmp(op, "-") == 0) x->num -= y->num;
-    else if (strcmp(op, "*") == 0) x->num *= y->num;
-    else if (strcmp(op, "/") == 0){
-      if (y->num == 0) {
-        hiss_val_del(x); 
-        hiss_val_del(y);
-        x = hiss_err("Division By Zero.");
-        break;
-      }
-      x->num /= y->num;
-    }
-    
-    hiss_val_del(y);
-  }
-  
-  hiss_val_del(a);
-  return x;
+
+  return NULL;
 }
 
 static hiss_val* builtin_head(hiss_env* e, hiss_val* a){    
   hiss_val* val = NULL;
-  char str[1];
   HISS_ASSERT_NUM("head", a, 1);
-  if (a->cells[0]->type == HISS_QEXPR) {
+  if (HISS_TYPE(a->cells[0]) == HISS_QEXPR) {
     HISS_ASSERT_NOT_EMPTY("head", a, 0);
 
-    val = hiss_val_take(a, 0);
-    while(val->count > 1) hiss_val_pop(val, 1);
-  } else if (a->cells[0]->type == HISS_STR) {
+    val = hiss_val_view(a->cells[0], 0, 1);
+  } else if (HISS_TYPE(a->cells[0]) == HISS_STR) {
     HISS_ASSERT_MIN_STRLEN("head", a, 0, 1);
 
-    strncpy(str, a->cells[0]->str, 1);
-    val = hiss_val_str(str);
+    val = hiss_val_substr(a->cells[0], 0, 1);
   } else {
-    HISS_ASSERT(a, HISS_FALSE, "head expects collection(string/list), but got %s.\n", hiss_type_name(a->cells[0]->type));
+    HISS_ASSERT(a, HISS_FALSE, "head expects collection(string/list), but got %s.\n", hiss_type_name(HISS_TYPE(a->cells[0])));
   }
   return val;
 }
 
 static hiss_val* builtin_tail(hiss_env* e, hiss_val* a){
   hiss_val* val = NULL;
-  char* str;
-  unsigned long len;
   HISS_ASSERT_NUM("tail", a, 1);
 
-  if (a->cells[0]->type == HISS_QEXPR) {
+  if (HISS_TYPE(a->cells[0]) == HISS_QEXPR) {
     HISS_ASSERT_NOT_EMPTY("tail", a, 0);
 
-    val = hiss_val_take(a, 0);  
-    hiss_val_pop(val, 0);
-  } else if (a->cells[0]->type == HISS_STR) {
-    HISS_ASSERT_MIN_STRLEN("head", a, 0, 1);
-
-    len = strlen(a->cells[0]->str) - 1;
-    str = malloc(sizeof(char) * len);
-    strncpy(str, &(a->cells[0]->str[1]), len);
+    val = hiss_val_view(a->cells[0], 1, a->cells[0]->count - 1);
+  } else if (HISS_TYPE(a->cells[0]) == HISS_STR) {
+    HISS_ASSERT_MIN_STRLEN("tail", a, 0, 1);
 
-    val = hiss_val_str(str);
+    val = hiss_val_substr(a->cells[0], 1, a->cells[0]->count - 1);
+  } else {
+    HISS_ASSERT(a, HISS_FALSE, "tail expects collection(string/list), but got %s.\n", hiss_type_name(HISS_TYPE(a->cells[0])));
   }
   return val;
 }
 
+/* The n characters of a string from from on, sharing them like tail. */
+static hiss_val* builtin_substr(hiss_env* e, hiss_val* a){
+  long from;
+  long n;
+
+  HISS_ASSERT_NUM("substr", a, 3);
+  HISS_ASSERT_TYPE("substr", a, 0, HISS_STR);
+  HISS_ASSERT_TYPE("substr", a, 1, HISS_NUM);
+  HISS_ASSERT_TYPE("substr", a, 2, HISS_NUM);
+
+  from = HISS_NUM_OF(a->cells[1]);
+  n = HISS_NUM_OF(a->cells[2]);
+  HISS_ASSERT(a, from >= 0 && n >= 0 && from + n <= (long) a->cells[0]->count,
+    "Function '%s' passed range %li+%li for a string of length %u.",
+    "substr", from, n, a->cells[0]->count);
+
+  return hiss_val_substr(a->cells[0], (unsigned int) from, (unsigned int) n);
+}
+
 static hiss_val* builtin_list(hiss_env* e, hiss_val* a) {
   a->type = HISS_QEXPR;
   return a;
 }
 
-static hiss_val* builtin_eval(hiss_env* e, hiss_val* a){
-  hiss_val* x = NULL;
+hiss_val* builtin_eval(hiss_env* e, hiss_val* a){
   HISS_ASSERT_NUM("eval", a, 1);
   HISS_ASSERT_TYPE("eval", a, 0, HISS_QEXPR);
 
-  x = hiss_val_take(a, 0);
-  x->type = HISS_SEXPR;
-  return hiss_val_eval(e, x);
+  return hiss_val_eval_sexpr(e, a->cells[0]);
 }
 
-static hiss_val* hiss_val_append(hiss_val* x, hiss_val* y) {
-  char* str = malloc(sizeof(char) * (strlen(x->str) + strlen(y->str)));
-  strcat(str, x->str);
-  strcat(str, y->str);
-  return hiss_val_str(str);
+/* The lists of a in one, sized and copied in one go. */
+static hiss_val* hiss_val_join_lists(hiss_val* a){
+  unsigned int i;
+  unsigned int n = 0;
+  hiss_val* x;
+  hiss_val* y;
+
+  for (i = 0; i < a->count; i++) n += a->cells[i]->count;
+
+  x = hiss_val_qexpr();
+  hiss_cells_reserve(x, n);
+
+  for (i = 0; (y = hiss_val_next(a, &i)); ) {
+    if (!y->count) continue;
+
+    memcpy(&x->cells[x->count], y->cells, sizeof(hiss_val*) * y->count);
+    x->count += y->count;
+  }
+
+  return x;
 }
 
-static hiss_val* hiss_val_join(hiss_env* e, hiss_val* x, hiss_val* y) {
-  if (x->type == HISS_QEXPR)
-    while (y->count)
-      x = hiss_val_add(x, hiss_val_pop(y, 0));
-  else if (x->type == HISS_STR)
-    x = hiss_val_append(x, y);
+/* Likewise for strings. */
+static hiss_val* hiss_val_join_strs(hiss_val* a){
+  unsigned int i;
+  unsigned int n = 0;
+  hiss_buffer* b;
+  hiss_val* x;
+
+  for (i = 0; i < a->count; i++) n += a->cells[i]->count;
+
+  b = hiss_buffer_new(n);
+  for (i = 0; i < a->count; i++) hiss_buffer_append(b, a->cells[i]->str, a->cells[i]->count);
+
+  x = hiss_val_str_take(hiss_buffer_take(b), n);
+  hiss_buffer_delete(b);
 
-  hiss_val_del(y);  
   return x;
 }
 
 static hiss_val* builtin_join(hiss_env*e, hiss_val* a) {
   unsigned int i; 
-  hiss_val* x;
-    
+  int t;
+
+  HISS_ASSERT(a, a->count > 0,
+    "Function '%s' passed incorrect number of arguments. "
+    "Got %i, expected at least %i.", "join", a->count, 1);
+
+  t = HISS_TYPE(a->cells[0]);
   for (i = 0; i < a->count; i++) {
-    HISS_ASSERT(a, (a->cells[i]->type == HISS_QEXPR || a->cells[i]->type == HISS_STR),
+    HISS_ASSERT(a, (HISS_TYPE(a->cells[i]) == HISS_QEXPR || HISS_TYPE(a->cells[i]) == HISS_STR),
       "Cannot join non-collection. Got %s, Expected Q-Expression or String.",
-      hiss_type_name(a->cells[i]->type));
+      hiss_type_name(HISS_TYPE(a->cells[i])));
+    HISS_ASSERT(a, HISS_TYPE(a->cells[i]) == t,
+      "Cannot join %s to %s.", hiss_type_name(HISS_TYPE(a->cells[i])), hiss_type_name(t));
   }
 
-  x = hiss_val_pop(a, 0);
+  /* one list is joined already and can be shared */
+  if (a->count == 1 && t == HISS_QEXPR) return a->cells[0];
 
-  while (a->count)
-    x = hiss_val_join(e, x, hiss_val_pop(a, 0));
-
-  hiss_val_del(a);
-  return x;
+  return t == HISS_QEXPR ? hiss_val_join_lists(a) : hiss_val_join_strs(a);
 }
 
-hiss_val* builtin_ord(hiss_env* e, hiss_val* a, const char* op){
-  unsigned short r;
-  HISS_ASSERT_NUM(op, a, 2);
-  HISS_ASSERT_TYPE(op, a, 0, HISS_NUM);
-  HISS_ASSERT_TYPE(op, a, 1, HISS_NUM);
-
-  if(strcmp(op, ">")  == 0)
-    r = (a->cells[0]->num >  a->cells[1]->num);
-  else if(strcmp(op, "<")  == 0)
-    r = (a->cells[0]->num <  a->cells[1]->num);
-  else if(strcmp(op, ">=") == 0)
-    r = (a->cells[0]->num >= a->cells[1]->num);
-  else if(strcmp(op, "<=") == 0)
-    r = (a->cells[0]->num <= a->cells[1]->num);
-  else if(strcmp(op, "||") == 0)
-    r = (a->cells[0]->num || a->cells[1]->num);
-  else if(strcmp(op, "&&") == 0)
-    r = (a->cells[0]->num && a->cells[1]->num);
-  else
-    r = 0;
+/* NULL if fun got two numbers, an error otherwise. */
+static hiss_val* check_ord(const char* fun, hiss_val* a){
+  HISS_ASSERT_NUM(fun, a, 2);
+  HISS_ASSERT_TYPE(fun, a, 0, HISS_NUM);
+  HISS_ASSERT_TYPE(fun, a, 1, HISS_NUM);
 
-
-  hiss_val_del(a);
-  return r == 0 ? hiss_val_bool(HISS_FALSE) : hiss_val_bool(HISS_TRUE);
+  return NULL;
 }
 
 static hiss_val* hiss_val_eq(hiss_val* x, hiss_val* y){
   unsigned int i;
-  if (x->type != y->type) return hiss_val_bool(HISS_FALSE);
+  if (HISS_TYPE(x) != HISS_TYPE(y)) return hiss_val_bool(HISS_FALSE);
 
-  switch (x->type){
-    case HISS_NUM: return hiss_val_bool(x->num == y->num);
+  switch (HISS_TYPE(x)){
+    case HISS_NUM: return hiss_val_bool(HISS_NUM_OF(x) == HISS_NUM_OF(y));
     case HISS_USR: return hiss_val_bool(x->type_name == y->type_name);
-    case HISS_STR: return hiss_val_bool(!(strcmp(x->str, y->str) == 0));
+    case HISS_STR: return hiss_val_bool(x->count == y->count && memcmp(x->str, y->str, x->count) == 0);
     case HISS_ERR: return hiss_val_bool(strcmp(x->err, y->err) == 0);
-    case HISS_SYM: return hiss_val_bool(strcmp(x->sym, y->sym) == 0);
+    case HISS_SYM: return hiss_val_bool(x->sym == y->sym);
     case HISS_FUN:
       if (x->fun || y->fun)
         return hiss_val_bool(x->fun == y->fun);
@@ -359,75 +412,71 @@ static hiss_val* hiss_val_eq(hiss_val* x, hiss_val* y){
           && hiss_val_eq(x->body, y->body));
     case HISS_QEXPR:
     case HISS_SEXPR:
+    case HISS_VEC:
       if (x->count != y->count) return hiss_val_bool(HISS_FALSE);
       for (i = 0; i < x->count; i++)
         if (!hiss_val_eq(x->cells[i], y->cells[i])) return hiss_val_bool(HISS_FALSE); 
       return hiss_val_bool(HISS_TRUE);
       break;
     case HISS_BOOL:
-      return hiss_val_bool(x->boolean == y->boolean);
+      return hiss_val_bool(HISS_BOOL_OF(x) == HISS_BOOL_OF(y));
+    case HISS_DICT:
+    case HISS_BUF:
+      return hiss_val_bool(x == y);
     default: break;
   }
   return hiss_val_bool(HISS_FALSE);
 }
 
-hiss_val* builtin_cmp(hiss_env* e, hiss_val* a, const char* op){
-    hiss_val* r;
-    HISS_ASSERT_NUM(op, a, 2);
-    
-    if(strcmp(op, "==") == 0){
-        r =  hiss_val_eq(a->cells[0], a->cells[1]);
-    }else{
-        r = hiss_val_eq(a->cells[0], a->cells[1]);
-        r->boolean = !(r->boolean);
-    }
-    
-    hiss_val_del(a);
-    return r;
-}
+/*
+ * Each comparison and logical operator has its own builtin, which reads
+ * its arguments where they are.
+ */
+#define HISS_ORD(name, fun, test) \
+  static hiss_val* name(hiss_env* e, hiss_val* a){ \
+    long x, y; \
+    hiss_val* err = check_ord(fun, a); \
+    if(err) return err; \
+    x = HISS_NUM_OF(a->cells[0]); \
+    y = HISS_NUM_OF(a->cells[1]); \
+    return hiss_val_bool((test) ? HISS_TRUE : HISS_FALSE); \
+  }
 
-static hiss_val* builtin_gt(hiss_env* e, hiss_val* a){
-    return builtin_ord(e, a, ">");
-}
+HISS_ORD(builtin_gt, ">", x > y)
+HISS_ORD(builtin_lt, "<", x < y)
+HISS_ORD(builtin_ge, ">=", x >= y)
+HISS_ORD(builtin_le, "<=", x <= y)
+HISS_ORD(builtin_or, "||", x || y)
+HISS_ORD(builtin_and, "&&", x && y)
 
-static hiss_val* builtin_lt(hiss_env* e, hiss_val* a){
-    return builtin_ord(e, a, "<");
-}
+static hiss_val* builtin_eq(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("==", a, 2);
 
-static hiss_val* builtin_ge(hiss_env* e, hiss_val* a){
-      return builtin_ord(e, a, ">=");
+  return hiss_val_eq(a->cells[0], a->cells[1]);
 }
 
-static hiss_val* builtin_le(hiss_env* e, hiss_val* a){
-      return builtin_ord(e, a, "<=");
-}
+static hiss_val* builtin_ne(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("!=", a, 2);
 
-static hiss_val* builtin_eq(hiss_env* e, hiss_val* a){
-      return builtin_cmp(e, a, "==");
+  return hiss_val_bool(HISS_BOOL_OF(hiss_val_eq(a->cells[0], a->cells[1])) ? HISS_FALSE : HISS_TRUE);
 }
 
-static hiss_val* builtin_ne(hiss_env* e, hiss_val* a){
-    return builtin_cmp(e, a, "!=");
-}
+static hiss_val* builtin_not(hiss_env* e, hiss_val* a){
+  hiss_val* x;
 
-static hiss_val* builtin_or(hiss_env* e, hiss_val* a){
-      return builtin_ord(e, a, "||");
-}
+  HISS_ASSERT_NUM("!", a, 1);
 
-static hiss_val* builtin_and(hiss_env* e, hiss_val* a){
-      return builtin_ord(e, a, "&&");
-}
+  x = a->cells[0];
 
-static hiss_val* builtin_not(hiss_env* e, hiss_val* a){
-      if(a->type == HISS_BOOL)
-          return a->boolean ? hiss_val_bool(HISS_TRUE) : hiss_val_bool(HISS_FALSE);
-      if(a->type == HISS_NUM)
-          return hiss_val_num(!a->num);
-      return hiss_err("'not' can only be applied to booleans or numbers, but got an %s.", 
-                      hiss_type_name(a->type));
+  if(HISS_TYPE(x) == HISS_BOOL)
+    return hiss_val_bool(HISS_BOOL_OF(x) ? HISS_FALSE : HISS_TRUE);
+  if(HISS_TYPE(x) == HISS_NUM)
+    return hiss_val_num(!HISS_NUM_OF(x));
+  return hiss_err("'not' can only be applied to booleans or numbers, but got an %s.", 
+                  hiss_type_name(HISS_TYPE(x)));
 }
 
-static hiss_val* builtin_if(hiss_env* e, hiss_val* a){
+hiss_val* builtin_if(hiss_env* e, hiss_val* a){
     hiss_val* x;
 
     if(a->count == 3){
@@ -437,24 +486,20 @@ static hiss_val* builtin_if(hiss_env* e, hiss_val* a){
     } 
     else if(a->count == 2){
         HISS_ASSERT_TYPE("if", a, 0, HISS_BOOL);
-        HISS_ASSERT_TYPE("if", a, 2, HISS_QEXPR);
+        HISS_ASSERT_TYPE("if", a, 1, HISS_QEXPR);
     }
     else{
         HISS_ASSERT(a, HISS_FALSE, "'if' takes either two arguments(if) or three(if/else), but got %i.", a->count);
     }
   
-    a->cells[1]->type = HISS_SEXPR;
-  
-    if (a->cells[0]->boolean) {
-      x = hiss_val_eval(e, hiss_val_pop(a, 1));
+    if (HISS_BOOL_OF(a->cells[0])) {
+      x = hiss_val_eval_sexpr(e, a->cells[1]);
     } else if (a->count == 3) {
-      a->cells[2]->type = HISS_SEXPR;
-      x = hiss_val_eval(e, hiss_val_pop(a, 2));
+      x = hiss_val_eval_sexpr(e, a->cells[2]);
     } else {
       x = hiss_val_qexpr();
     }
   
-    hiss_val_del(a);
     return x;
 }
 
@@ -463,9 +508,9 @@ hiss_val* hiss_val_copy(const hiss_val* val){
   hiss_val* c;
   
   if (val == NULL) return NULL;
+  if (HISS_IS_IMM(val)) return (hiss_val*) val;
 
-  c= (hiss_val*) malloc(sizeof(hiss_val));
-  c->type = val->type;
+  c = hiss_val_alloc(val->type);
   
   switch (val->type) {
     case HISS_FUN:
@@ -476,33 +521,42 @@ hiss_val* hiss_val_copy(const hiss_val* val){
           c->env = hiss_env_copy(val->env);
           c->formals = hiss_val_copy(val->formals);
           c->body = hiss_val_copy(val->body);
+          c->code = hiss_chunk_retain(val->code);
       }
       break;
     case HISS_NUM: c->num = val->num; break;
     case HISS_USR: 
-      c->type_name = val->type_name; 
+      c->type_name = (char*) malloc(strlen(val->type_name) + 1);
+      strcpy(c->type_name, val->type_name);
       c->formals = hiss_val_copy(val->formals);
       break;
     case HISS_STR: 
-      c->str = (char*) malloc(strlen(val->str + 1)); 
-      strcpy(c->str, val->str);
+      c->count = val->count;
+      c->str = (char*) malloc(val->count + 1);
+      memcpy(c->str, val->str, val->count);
+      c->str[c->count] = '\0';
       break;
-    case HISS_BOOL: c->boolean = val->boolean; break;
     case HISS_ERR:
       c->err = (char*) malloc(strlen(val->err) + 1);
       strcpy(c->err, val->err); 
       break;
-    case HISS_SYM:
-      c->sym = (char*) malloc(strlen(val->sym) + 1);
-      strcpy(c->sym, val->sym); 
-      break;
+    case HISS_SYM: c->sym = val->sym; break;
     case HISS_SEXPR:
     case HISS_QEXPR:
+    case HISS_VEC:
       c->count = val->count;
-      c->cells = (hiss_val**) malloc(sizeof(hiss_val*) * c->count);
+      hiss_cells_reserve(c, c->count);
       for(i = 0; i < c->count; i++)
         c->cells[i] = hiss_val_copy(val->cells[i]);
        break;
+    case HISS_DICT:
+      c->count = val->count;
+      c->table = hiss_table_copy(val->table);
+      break;
+    case HISS_BUF:
+      c->buf = hiss_buffer_new(val->buf->len);
+      hiss_buffer_append(c->buf, val->buf->data, val->buf->len);
+      break;
     default:
        break;
   }
@@ -511,9 +565,9 @@ hiss_val* hiss_val_copy(const hiss_val* val){
 }
 
 const hiss_val* hiss_env_get(hiss_env* e, hiss_val* k){
-  hiss_val* v = hiss_val_copy(hiss_table_get(e->vals, k->sym));
+  const hiss_val* v = hiss_env_get_local(e, k->sym);
 
-  if(v != HISS_ERR) return v;
+  if(v) return v;
 
   if(e->par)
       return hiss_env_get(e->par, k);
@@ -523,7 +577,7 @@ const hiss_val* hiss_env_get(hiss_env* e, hiss_val* k){
 }
 
 const hiss_val* hiss_env_type_get(hiss_env* e, const char* k){
-  hiss_val* v = hiss_val_copy(hiss_type_get(e->types, k));
+  const hiss_val* v = e->types ? hiss_type_get(e->types, k) : NULL;
 
   if(v) return v;
 
@@ -534,71 +588,674 @@ const hiss_val* hiss_env_type_get(hiss_env* e, const char* k){
 }
 
 const hiss_val* hiss_env_put(hiss_env* e, hiss_val* k, hiss_val* v){
-  return hiss_table_insert(e->vals, k->sym, v);
+  return hiss_env_put_local(e, k->sym, v);
 }
 
 const hiss_val* hiss_env_remove(hiss_env* e, hiss_val* k){
-  return hiss_table_remove(e->vals, k->sym);
+  return hiss_env_remove_local(e, k->sym);
 }
 
 void hiss_env_type_put(hiss_env* e, const char* k, hiss_val* v){
-  hiss_type_insert(e->types, k, v);
+  hiss_type_insert(hiss_env_types(e), k, v);
 }
 
 hiss_val* hiss_val_eval(hiss_env* e, hiss_val* v){
   //hiss_val_print(v);
   //printf(" ");
-  if (v->type == HISS_SYM) {
+  if (HISS_TYPE(v) == HISS_SYM) {
     hiss_val* x = (hiss_val*) hiss_env_get(e, v);
     //hiss_val_println(x);
     return x;
   }
   //(puts("");
   
-  if(v->type == HISS_SEXPR) return hiss_val_eval_sexpr(e, v);
+  if(HISS_TYPE(v) == HISS_SEXPR) return hiss_val_eval_sexpr(e, v);
   return v;
 }
 
 hiss_val* hiss_val_eval_sexpr(hiss_env* e, hiss_val* v){
-  /* TODO: Tail call elimination */
-  unsigned int i;
-  hiss_val* f = NULL;
-  hiss_val* err = NULL;
+  hiss_chunk* c = NULL;
   hiss_val* result = NULL;
 
-  for(i = 0; i < v->count; i++) v->cells[i] = hiss_val_eval(e, v->cells[i]);
-  
-  for(i = 0; i < v->count; i++) if(v->cells[i]->type == HISS_ERR) return hiss_val_take(v, i);
+  if(v->count == 0) return hiss_val_sexpr();
 
-  if(v->count == 0) return v; 
-  if(v->count == 1) return hiss_val_take(v, 0);
+  c = hiss_compile_body(v);
 
-  f = hiss_val_pop(v, 0);
-  if(f->type != HISS_FUN){
-    err = hiss_err("S-Expression starts with incorrect type. Got %s, expected %s.",
-                   hiss_type_name(f->type), hiss_type_name(HISS_FUN));
-    hiss_val_del(v); 
-    return err;
-  }
+  result = hiss_vm_run(e, c);
+  hiss_chunk_release(c);
 
-  result = hiss_val_call(e, f, v);
   return result;
 }
 
+/*
+ * The arithmetic builtins fold their arguments from left to right,
+ * reading them where they are.
+ */
 static hiss_val* builtin_add(hiss_env* e, hiss_val* a){
-  return builtin_op(e, a, "+");
+  unsigned int i;
+  long n;
+  hiss_val* err = check_nums("+", a);
+
+  if(err) return err;
+
+  n = HISS_NUM_OF(a->cells[0]);
+  for(i = 1; i < a->count; i++) n += HISS_NUM_OF(a->cells[i]);
+
+  return hiss_val_num(n);
 }
 
 static hiss_val* builtin_sub(hiss_env* e, hiss_val* a){
-  return builtin_op(e, a, "-");
+  unsigned int i;
+  long n;
+  hiss_val* err = check_nums("-", a);
+
+  if(err) return err;
+
+  n = HISS_NUM_OF(a->cells[0]);
+  if(a->count == 1) return hiss_val_num(-n);
+
+  for(i = 1; i < a->count; i++) n -= HISS_NUM_OF(a->cells[i]);
+
+  return hiss_val_num(n);
 }
 
 static hiss_val* builtin_mul(hiss_env* e, hiss_val* a){
-  return builtin_op(e, a, "*");
+  unsigned int i;
+  long n;
+  hiss_val* err = check_nums("*", a);
+
+  if(err) return err;
+
+  n = HISS_NUM_OF(a->cells[0]);
+  for(i = 1; i < a->count; i++) n *= HISS_NUM_OF(a->cells[i]);
+
+  return hiss_val_num(n);
 }
 
 static hiss_val* builtin_div(hiss_env* e, hiss_val* a){
-  return builtin_op(e, a, "/");
+  unsigned int i;
+  long n, m;
+  hiss_val* err = check_nums("/", a);
+
+  if(err) return err;
+
+  n = HISS_NUM_OF(a->cells[0]);
+  for(i = 1; i < a->count; i++){
+    m = HISS_NUM_OF(a->cells[i]);
+    if (m == 0) return hiss_err("Division By Zero.");
+    n /= m;
+  }
+
+  return hiss_val_num(n);
+}
+
+/*
+ * Vectors index in constant time. vec-set! and vec-push! change the
+ * vector they are given; the other builtins leave it alone.
+ */
+
+/* NULL if i is below end, an error naming fun otherwise. */
+static hiss_val* check_index(const char* fun, const hiss_val* v, long i, unsigned int end){
+  HISS_ASSERT(v, i >= 0 && i < (long) end,
+    "Function '%s' passed index %li for a vector of length %u.", fun, i, v->count);
+
+  return NULL;
+}
+
+/* Appends n cells of src from from on to dst. */
+static hiss_val* copy_cells(hiss_val* dst, const hiss_val* src, unsigned int from, unsigned int n){
+  if(!n) return dst;
+
+  hiss_cells_reserve(dst, dst->count + n);
+  memcpy(&dst->cells[dst->count], &src->cells[from], sizeof(hiss_val*) * n);
+  dst->count += n;
+
+  return dst;
+}
+
+static hiss_val* builtin_vec(hiss_env* e, hiss_val* a){
+  a->type = HISS_VEC;
+  return a;
+}
+
+static hiss_val* builtin_vec_len(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("vec-len", a, 1);
+  HISS_ASSERT_TYPE("vec-len", a, 0, HISS_VEC);
+
+  return hiss_val_num(a->cells[0]->count);
+}
+
+static hiss_val* builtin_vec_get(hiss_env* e, hiss_val* a){
+  hiss_val* err;
+  long i;
+
+  HISS_ASSERT_NUM("vec-get", a, 2);
+  HISS_ASSERT_TYPE("vec-get", a, 0, HISS_VEC);
+  HISS_ASSERT_TYPE("vec-get", a, 1, HISS_NUM);
+
+  i = HISS_NUM_OF(a->cells[1]);
+  if((err = check_index("vec-get", a->cells[0], i, a->cells[0]->count))) return err;
+
+  return a->cells[0]->cells[i];
+}
+
+static hiss_val* builtin_vec_set(hiss_env* e, hiss_val* a){
+  hiss_val* err;
+  long i;
+
+  HISS_ASSERT_NUM("vec-set!", a, 3);
+  HISS_ASSERT_TYPE("vec-set!", a, 0, HISS_VEC);
+  HISS_ASSERT_TYPE("vec-set!", a, 1, HISS_NUM);
+
+  i = HISS_NUM_OF(a->cells[1]);
+  if((err = check_index("vec-set!", a->cells[0], i, a->cells[0]->count))) return err;
+
+  a->cells[0]->cells[i] = a->cells[2];
+
+  return a->cells[0];
+}
+
+static hiss_val* builtin_vec_push(hiss_env* e, hiss_val* a){
+  HISS_ASSERT(a, a->count >= 2,
+    "Function '%s' passed incorrect number of arguments. "
+    "Got %i, expected at least %i.", "vec-push!", a->count, 2);
+  HISS_ASSERT_TYPE("vec-push!", a, 0, HISS_VEC);
+
+  return copy_cells(a->cells[0], a, 1, a->count - 1);
+}
+
+static hiss_val* builtin_vec_slice(hiss_env* e, hiss_val* a){
+  hiss_val* v;
+  hiss_val* err;
+  long from, to;
+
+  HISS_ASSERT_NUM("vec-slice", a, 3);
+  HISS_ASSERT_TYPE("vec-slice", a, 0, HISS_VEC);
+  HISS_ASSERT_TYPE("vec-slice", a, 1, HISS_NUM);
+  HISS_ASSERT_TYPE("vec-slice", a, 2, HISS_NUM);
+
+  v = a->cells[0];
+  from = HISS_NUM_OF(a->cells[1]);
+  to = HISS_NUM_OF(a->cells[2]);
+
+  /* to is exclusive and may be the length */
+  if((err = check_index("vec-slice", v, to, v->count + 1))) return err;
+  if((err = check_index("vec-slice", v, from, (unsigned int) to + 1))) return err;
+
+  return copy_cells(hiss_val_vec(), v, (unsigned int) from, (unsigned int) (to - from));
+}
+
+static hiss_val* builtin_vec_to_list(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("vec->list", a, 1);
+  HISS_ASSERT_TYPE("vec->list", a, 0, HISS_VEC);
+
+  return copy_cells(hiss_val_qexpr(), a->cells[0], 0, a->cells[0]->count);
+}
+
+static hiss_val* builtin_list_to_vec(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("list->vec", a, 1);
+  HISS_ASSERT_TYPE("list->vec", a, 0, HISS_QEXPR);
+
+  return copy_cells(hiss_val_vec(), a->cells[0], 0, a->cells[0]->count);
+}
+
+/*
+ * Dictionaries file each key under a name made of its type and its
+ * text, so that 1 and "1" are different keys. Their tables keep copies
+ * of the names of the keys they hold, nothing is interned; looking a
+ * key up only builds its name for the time being. Names are compared
+ * by their length, strings may hold NUL bytes. Like vectors, they
+ * are changed in place by the builtins ending in '!'.
+ */
+
+#define DICT_KEY_SIZE 32
+
+static int dict_keyable(hiss_val* k){
+  switch(HISS_TYPE(k)){
+    case HISS_NUM:
+    case HISS_BOOL:
+    case HISS_STR:
+    case HISS_SYM: return 1;
+    default: return 0;
+  }
+}
+
+/*
+ * The name k is filed under and its length in *size, in buf of
+ * DICT_KEY_SIZE if it fits and allocated if not; see dict_key_free.
+ */
+static char* dict_key(hiss_val* k, char* buf, size_t* size){
+  const char* text;
+  char* name;
+  size_t len;
+
+  switch(HISS_TYPE(k)){
+    case HISS_NUM:
+      *size = (size_t) snprintf(buf, DICT_KEY_SIZE, "n%li", HISS_NUM_OF(k));
+      return buf;
+    case HISS_BOOL:
+      strcpy(buf, HISS_BOOL_OF(k) ? "b1" : "b0");
+      *size = 2;
+      return buf;
+    case HISS_STR:
+      text = k->str;
+      len = k->count;
+      break;
+    default:
+      text = k->sym;
+      len = strlen(text);
+      break;
+  }
+
+  name = len + 2 <= DICT_KEY_SIZE ? buf : (char*) malloc(len + 2);
+  name[0] = HISS_TYPE(k) == HISS_STR ? 's' : 'y';
+  memcpy(name + 1, text, len);
+  name[len + 1] = '\0';
+  *size = len + 1;
+
+  return name;
+}
+
+static void dict_key_free(char* key, char* buf){
+  if(key != buf) free(key);
+}
+
+#define HISS_ASSERT_KEY(fun, args, index) \
+  HISS_ASSERT(args, dict_keyable(args->cells[index]), \
+    "Function '%s' passed %s as a key, expected Number, Boolean, String or Symbol.", \
+    fun, hiss_type_name(HISS_TYPE(args->cells[index])))
+
+/* The {k v} pair of k in d, or NULL. */
+static const hiss_val* dict_get(hiss_val* d, hiss_val* k){
+  char buf[DICT_KEY_SIZE];
+  size_t len;
+  char* key = dict_key(k, buf, &len);
+  const hiss_val* pair = hiss_table_get_len(d->table, key, len);
+
+  dict_key_free(key, buf);
+
+  return pair;
+}
+
+/* Binds k to v in d, counting k if it is new. */
+static void dict_put(hiss_val* d, hiss_val* k, hiss_val* v){
+  char buf[DICT_KEY_SIZE];
+  size_t len;
+  char* key = dict_key(k, buf, &len);
+  hiss_val* pair = hiss_val_qexpr();
+
+  pair = hiss_val_add(pair, k);
+  pair = hiss_val_add(pair, v);
+
+  if(!hiss_table_put_len(d->table, key, len, pair)) d->count++;
+
+  dict_key_free(key, buf);
+}
+
+static void dict_remove(hiss_val* d, hiss_val* k){
+  char buf[DICT_KEY_SIZE];
+  size_t len;
+  char* key = dict_key(k, buf, &len);
+
+  if(hiss_table_get_len(d->table, key, len)){
+    hiss_table_remove_len(d->table, key, len);
+    d->count--;
+  }
+
+  dict_key_free(key, buf);
+}
+
+static hiss_val* builtin_dict(hiss_env* e, hiss_val* a){
+  unsigned int i;
+  hiss_val* d;
+
+  HISS_ASSERT(a, a->count % 2 == 0,
+    "Function '%s' passed %i arguments, expected keys and values in pairs.",
+    "dict", a->count);
+
+  for(i = 0; i < a->count; i += 2) HISS_ASSERT_KEY("dict", a, i);
+
+  d = hiss_val_dict(a->count);
+  for(i = 0; i < a->count; i += 2) dict_put(d, a->cells[i], a->cells[i+1]);
+
+  return d;
+}
+
+static hiss_val* builtin_dict_new(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-new", a, 1);
+  HISS_ASSERT_TYPE("dict-new", a, 0, HISS_NUM);
+  HISS_ASSERT(a, HISS_NUM_OF(a->cells[0]) >= 0 && HISS_NUM_OF(a->cells[0]) <= UINT_MAX / 2,
+    "Function '%s' passed an invalid size %li.", "dict-new", HISS_NUM_OF(a->cells[0]));
+
+  return hiss_val_dict((unsigned int) HISS_NUM_OF(a->cells[0]));
+}
+
+static hiss_val* builtin_dict_size(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-size", a, 1);
+  HISS_ASSERT_TYPE("dict-size", a, 0, HISS_DICT);
+
+  return hiss_val_num(a->cells[0]->count);
+}
+
+static hiss_val* builtin_dict_get(hiss_env* e, hiss_val* a){
+  const hiss_val* pair;
+
+  HISS_ASSERT_NUM("dict-get", a, 2);
+  HISS_ASSERT_TYPE("dict-get", a, 0, HISS_DICT);
+  HISS_ASSERT_KEY("dict-get", a, 1);
+
+  pair = dict_get(a->cells[0], a->cells[1]);
+  if(!pair) return hiss_err("Key not found in dictionary.");
+
+  return pair->cells[1];
+}
+
+static hiss_val* builtin_dict_has(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-has?", a, 2);
+  HISS_ASSERT_TYPE("dict-has?", a, 0, HISS_DICT);
+  HISS_ASSERT_KEY("dict-has?", a, 1);
+
+  return hiss_val_bool(dict_get(a->cells[0], a->cells[1]) ? HISS_TRUE : HISS_FALSE);
+}
+
+static hiss_val* builtin_dict_put(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-put!", a, 3);
+  HISS_ASSERT_TYPE("dict-put!", a, 0, HISS_DICT);
+  HISS_ASSERT_KEY("dict-put!", a, 1);
+
+  dict_put(a->cells[0], a->cells[1], a->cells[2]);
+
+  return a->cells[0];
+}
+
+static hiss_val* builtin_dict_remove(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-remove!", a, 2);
+  HISS_ASSERT_TYPE("dict-remove!", a, 0, HISS_DICT);
+  HISS_ASSERT_KEY("dict-remove!", a, 1);
+
+  dict_remove(a->cells[0], a->cells[1]);
+
+  return a->cells[0];
+}
+
+/* The keys of the dictionary, or its {key value} pairs with pairs set. */
+static hiss_val* dict_list(hiss_val* d, int pairs){
+  unsigned int i = 0;
+  const hiss_entry* entry;
+  hiss_val* l = hiss_val_qexpr();
+
+  hiss_cells_reserve(l, d->count);
+
+  while((entry = hiss_table_next(d->table, &i)))
+    if(entry->value)
+      l->cells[l->count++] = pairs ? (hiss_val*) entry->value : entry->value->cells[0];
+
+  return l;
+}
+
+static hiss_val* builtin_dict_keys(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-keys", a, 1);
+  HISS_ASSERT_TYPE("dict-keys", a, 0, HISS_DICT);
+
+  return dict_list(a->cells[0], HISS_FALSE);
+}
+
+static hiss_val* builtin_dict_items(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("dict-items", a, 1);
+  HISS_ASSERT_TYPE("dict-items", a, 0, HISS_DICT);
+
+  return dict_list(a->cells[0], HISS_TRUE);
+}
+
+/*
+ * Buffers are strings that grow in place, for building a string out of
+ * many pieces in linear time where join would copy it over and over.
+ */
+
+/* Appends the strings of a from from on to b. */
+static hiss_val* buffer_append(const char* fun, hiss_val* b, hiss_val* a, unsigned int from){
+  unsigned int i;
+
+  for(i = from; i < a->count; i++) HISS_ASSERT_TYPE(fun, a, i, HISS_STR);
+  for(i = from; i < a->count; i++) hiss_buffer_append(b->buf, a->cells[i]->str, a->cells[i]->count);
+
+  return b;
+}
+
+static hiss_val* builtin_buffer(hiss_env* e, hiss_val* a){
+  return buffer_append("buffer", hiss_val_buf(0), a, 0);
+}
+
+static hiss_val* builtin_buffer_append(hiss_env* e, hiss_val* a){
+  HISS_ASSERT(a, a->count > 0,
+    "Function '%s' passed incorrect number of arguments. "
+    "Got %i, expected at least %i.", "buffer-append!", a->count, 1);
+  HISS_ASSERT_TYPE("buffer-append!", a, 0, HISS_BUF);
+
+  return buffer_append("buffer-append!", a->cells[0], a, 1);
+}
+
+static hiss_val* builtin_buffer_len(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("buffer-len", a, 1);
+  HISS_ASSERT_TYPE("buffer-len", a, 0, HISS_BUF);
+
+  return hiss_val_num((long) a->cells[0]->buf->len);
+}
+
+static hiss_val* builtin_buffer_to_str(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("buffer->str", a, 1);
+  HISS_ASSERT_TYPE("buffer->str", a, 0, HISS_BUF);
+
+  return hiss_val_str_len(a->cells[0]->buf->data, (unsigned int) a->cells[0]->buf->len);
+}
+
+/*
+ * The list functions of the standard library that are worth doing in
+ * C; lib/stdlib/list.his has them in Hiss. The ones taking a function
+ * call it through hiss_val_call, which may collect garbage, so they
+ * keep their arguments and what they build protected.
+ */
+
+static hiss_val* builtin_len(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("len", a, 1);
+  HISS_ASSERT_TYPE("len", a, 0, HISS_QEXPR);
+
+  return hiss_val_num(a->cells[0]->count);
+}
+
+static hiss_val* builtin_reverse(hiss_env* e, hiss_val* a){
+  unsigned int i;
+  hiss_val* l;
+  hiss_val* r;
+
+  HISS_ASSERT_NUM("reverse", a, 1);
+  HISS_ASSERT_TYPE("reverse", a, 0, HISS_QEXPR);
+
+  l = a->cells[0];
+  r = hiss_val_qexpr();
+  hiss_cells_reserve(r, l->count);
+
+  for(i = l->count; i > 0; i--) r->cells[r->count++] = l->cells[i-1];
+
+  return r;
+}
+
+static hiss_val* builtin_nth(hiss_env* e, hiss_val* a){
+  long n;
+
+  HISS_ASSERT_NUM("nth", a, 2);
+  HISS_ASSERT_TYPE("nth", a, 0, HISS_NUM);
+  HISS_ASSERT_TYPE("nth", a, 1, HISS_QEXPR);
+
+  n = HISS_NUM_OF(a->cells[0]);
+  HISS_ASSERT(a, n >= 0 && n < (long) a->cells[1]->count,
+    "Function '%s' passed index %li for a list of length %u.", "nth", n, a->cells[1]->count);
+
+  return a->cells[1]->cells[n];
+}
+
+static hiss_val* builtin_last(hiss_env* e, hiss_val* a){
+  HISS_ASSERT_NUM("last", a, 1);
+  HISS_ASSERT_TYPE("last", a, 0, HISS_QEXPR);
+  HISS_ASSERT_NOT_EMPTY("last", a, 0);
+
+  return a->cells[0]->cells[a->cells[0]->count - 1];
+}
+
+/*
+ * Gives the collector its chance between two calls, which builtins
+ * would otherwise not, keeping v alive.
+ */
+static void collect_with(hiss_val* v){
+  hiss_gc_protect(v);
+  hiss_gc_poll();
+  hiss_gc_unprotect(1);
+}
+
+/* Calls f with x and y. */
+static hiss_val* call2(hiss_env* e, hiss_val* f, hiss_val* x, hiss_val* y){
+  hiss_val* args = hiss_val_sexpr();
+
+  hiss_cells_reserve(args, 2);
+  args->cells[args->count++] = x;
+  args->cells[args->count++] = y;
+
+  return hiss_val_call(e, f, args);
+}
+
+static hiss_val* builtin_foldl(hiss_env* e, hiss_val* a){
+  unsigned int i;
+  hiss_val* f;
+  hiss_val* l;
+  hiss_val* acc;
+
+  HISS_ASSERT_NUM("foldl", a, 3);
+  HISS_ASSERT_TYPE("foldl", a, 0, HISS_FUN);
+  HISS_ASSERT_TYPE("foldl", a, 2, HISS_QEXPR);
+
+  f = a->cells[0];
+  acc = a->cells[1];
+  l = a->cells[2];
+
+  hiss_gc_protect(a);
+  for(i = 0; i < l->count && HISS_TYPE(acc) != HISS_ERR; i++){
+    collect_with(acc);
+    acc = call2(e, f, acc, l->cells[i]);
+  }
+  hiss_gc_unprotect(1);
+
+  return acc;
+}
+
+static hiss_val* builtin_foldr(hiss_env* e, hiss_val* a){
+  unsigned int i;
+  hiss_val* f;
+  hiss_val* l;
+  hiss_val* acc;
+
+  HISS_ASSERT_NUM("foldr", a, 3);
+  HISS_ASSERT_TYPE("foldr", a, 0, HISS_FUN);
+  HISS_ASSERT_TYPE("foldr", a, 2, HISS_QEXPR);
+
+  f = a->cells[0];
+  acc = a->cells[1];
+  l = a->cells[2];
+
+  hiss_gc_protect(a);
+  for(i = l->count; i > 0 && HISS_TYPE(acc) != HISS_ERR; i--){
+    collect_with(acc);
+    acc = call2(e, f, l->cells[i-1], acc);
+  }
+  hiss_gc_unprotect(1);
+
+  return acc;
+}
+
+static hiss_val* builtin_map(hiss_env* e, hiss_val* a){
+  unsigned int i;
+  hiss_val* f;
+  hiss_val* l;
+  hiss_val* r;
+  hiss_val* x;
+  hiss_val* args;
+
+  HISS_ASSERT_NUM("map", a, 2);
+  HISS_ASSERT_TYPE("map", a, 0, HISS_FUN);
+  HISS_ASSERT_TYPE("map", a, 1, HISS_QEXPR);
+
+  f = a->cells[0];
+  l = a->cells[1];
+  r = hiss_val_qexpr();
+  hiss_cells_reserve(r, l->count);
+
+  hiss_gc_protect(a);
+  hiss_gc_protect(r);
+  for(i = 0; i < l->count; i++){
+    hiss_gc_poll();
+
+    args = hiss_val_sexpr();
+    args = hiss_val_add(args, l->cells[i]);
+
+    x = hiss_val_call(e, f, args);
+    if(HISS_TYPE(x) == HISS_ERR){
+      r = x;
+      break;
+    }
+
+    r->cells[r->count++] = x;
+  }
+  hiss_gc_unprotect(2);
+
+  return r;
+}
+
+/* Folds a list of numbers with op, starting from n. */
+static hiss_val* fold_nums(const char* fun, hiss_val* a, long n, char op){
+  unsigned int i;
+  hiss_val* l;
+
+  HISS_ASSERT_NUM(fun, a, 1);
+  HISS_ASSERT_TYPE(fun, a, 0, HISS_QEXPR);
+
+  l = a->cells[0];
+  for(i = 0; i < l->count; i++){
+    HISS_ASSERT(a, HISS_TYPE(l->cells[i]) == HISS_NUM,
+      "Function '%s' passed a list containing %s, expected only Numbers.",
+      fun, hiss_type_name(HISS_TYPE(l->cells[i])));
+
+    if(op == '+') n += HISS_NUM_OF(l->cells[i]);
+    else n *= HISS_NUM_OF(l->cells[i]);
+  }
+
+  return hiss_val_num(n);
+}
+
+static hiss_val* builtin_sum(hiss_env* e, hiss_val* a){
+  return fold_nums("sum", a, 0, '+');
+}
+
+static hiss_val* builtin_product(hiss_env* e, hiss_val* a){
+  return fold_nums("product", a, 1, '*');
+}
+
+static hiss_val* builtin_range(hiss_env* e, hiss_val* a){
+  long i;
+  long n;
+  hiss_val* r;
+
+  HISS_ASSERT_NUM("range", a, 1);
+  HISS_ASSERT_TYPE("range", a, 0, HISS_NUM);
+
+  n = HISS_NUM_OF(a->cells[0]);
+  HISS_ASSERT(a, n >= 0 && n <= UINT_MAX / 2,
+    "Function '%s' passed an invalid length %li.", "range", n);
+
+  r = hiss_val_qexpr();
+  hiss_cells_reserve(r, (unsigned int) n);
+
+  for(i = 0; i < n; i++) r->cells[r->count++] = hiss_val_num(i);
+
+  return r;
 }
 
 static hiss_val* builtin_true(hiss_env* e, hiss_val* a){
@@ -613,21 +1270,26 @@ static hiss_val* builtin_lambda(hiss_env* e, hiss_val* a){
   unsigned int i;
   hiss_val* formals = NULL;
   hiss_val* body = NULL;
+  hiss_val* lambda = NULL;
 
   HISS_ASSERT_NUM("lambda", a, 2);
   HISS_ASSERT_TYPE("lambda", a, 0, HISS_QEXPR);
   HISS_ASSERT_TYPE("lambda", a, 1, HISS_QEXPR);
   
   for (i = 0; i < a->cells[0]->count; i++)
-    HISS_ASSERT(a, (a->cells[0]->cells[i]->type == HISS_SYM),
+    HISS_ASSERT(a, (HISS_TYPE(a->cells[0]->cells[i]) == HISS_SYM),
       "Cannot define non-symbol. Got %s, Expected %s.",
-      hiss_type_name(a->cells[0]->cells[i]->type), hiss_type_name(HISS_SYM));
+      hiss_type_name(HISS_TYPE(a->cells[0]->cells[i])), hiss_type_name(HISS_SYM));
   
-  formals = hiss_val_pop(a, 0);
-  body = hiss_val_pop(a, 0);
-  hiss_val_del(a);
-  
-  return hiss_val_lambda(formals, body);
+  formals = a->cells[0];
+  body = a->cells[1];
+
+  lambda = hiss_val_lambda(formals, body);
+  lambda->env->par = e;
+  lambda->env->body = body;
+  lambda->code = hiss_compile_lambda(formals, body, e);
+
+  return lambda;
 }
 
 static hiss_val* builtin_var(hiss_env* e, hiss_val* a, const char* fun){
@@ -642,9 +1304,9 @@ static hiss_val* builtin_var(hiss_env* e, hiss_val* a, const char* fun){
     syms = a->cells[0];
 
     for(i = 0; i < syms->count; i++)
-        HISS_ASSERT(a, (syms->cells[i]->type == HISS_SYM),
+        HISS_ASSERT(a, (HISS_TYPE(syms->cells[i]) == HISS_SYM),
                     "Function %s cannot define non-symbol. Got %s, expected %s", fun,
-                    hiss_type_name(syms->cells[i]->type),
+                    hiss_type_name(HISS_TYPE(syms->cells[i])),
                     hiss_type_name(HISS_SYM));
 
     HISS_ASSERT(a, (syms->count == a->count-1),
@@ -652,13 +1314,11 @@ static hiss_val* builtin_var(hiss_env* e, hiss_val* a, const char* fun){
                 fun, syms->count, a->count-1);
 
     for(i = 0; i < syms->count; i++){
-        if(def) check = (hiss_val*) hiss_env_def(e, hiss_val_copy(syms->cells[i]), hiss_val_copy(a->cells[i+1]));
-        if(equals) check = (hiss_val*) hiss_env_put(e, hiss_val_copy(syms->cells[i]), hiss_val_copy(a->cells[i+1]));
-        if(check->type == HISS_ERR) break;
+        if(def) check = (hiss_val*) hiss_env_def(e, syms->cells[i], a->cells[i+1]);
+        if(equals) check = (hiss_val*) hiss_env_put(e, syms->cells[i], a->cells[i+1]);
+        if(HISS_TYPE(check) == HISS_ERR) break;
     }
 
-    hiss_val_del(a);
-
     return check;
 }
 
@@ -666,9 +1326,47 @@ static hiss_val* builtin_def(hiss_env* e, hiss_val* a){
     return builtin_var(e, a, "def");
 }
 
+/*
+ * (fun {name formals...} body) defines name globally as the lambda of
+ * formals and body, closed over the caller like any other lambda.
+ */
+static hiss_val* builtin_fun(hiss_env* e, hiss_val* a){
+  hiss_val* sig = NULL;
+  hiss_val* lambda = NULL;
+  hiss_val* def = NULL;
+
+  HISS_ASSERT_NUM("fun", a, 2);
+  HISS_ASSERT_TYPE("fun", a, 0, HISS_QEXPR);
+  HISS_ASSERT_TYPE("fun", a, 1, HISS_QEXPR);
+  HISS_ASSERT_NOT_EMPTY("fun", a, 0);
+
+  sig = a->cells[0];
+  lambda = hiss_val_add(hiss_val_sexpr(), hiss_val_view(sig, 1, sig->count-1));
+  lambda = builtin_lambda(e, hiss_val_add(lambda, a->cells[1]));
+  if(HISS_TYPE(lambda) == HISS_ERR) return lambda;
+
+  def = hiss_val_add(hiss_val_sexpr(), hiss_val_view(sig, 0, 1));
+  return builtin_def(e, hiss_val_add(def, lambda));
+}
+
+/*
+ * (let body) evaluates body in a frame of its own, so that = binds
+ * there, with the caller's bindings still visible.
+ */
+static hiss_val* builtin_let(hiss_env* e, hiss_val* a){
+  hiss_env* n = NULL;
+
+  HISS_ASSERT_NUM("let", a, 1);
+  HISS_ASSERT_TYPE("let", a, 0, HISS_QEXPR);
+
+  n = hiss_env_new();
+  n->par = e;
+  return hiss_val_eval_sexpr(n, a->cells[0]);
+}
+
 static hiss_val* builtin_del(hiss_env* e, hiss_val* a){
     unsigned long i;
-    hiss_val *v;
+    hiss_val *v = hiss_val_bool(HISS_TRUE);
     hiss_val* del = NULL;
 
     HISS_ASSERT_NUM("del!", a, 1);
@@ -678,7 +1376,7 @@ static hiss_val* builtin_del(hiss_env* e, hiss_val* a){
 
     for(i = 0; i < del->count; i++){
       v = (hiss_val*) hiss_env_remove(e, del->cells[i]);
-      if (v->type != HISS_BOOL) break;
+      if (HISS_TYPE(v) != HISS_BOOL) break;
     }
     return v;
 }
@@ -692,7 +1390,7 @@ static hiss_val* builtin_type(hiss_env* e, hiss_val* a){
 
     HISS_ASSERT_NUM("type?", a, 1);
 
-    if(a->type != HISS_USR) return hiss_val_str(hiss_type_name(a->type));
+    if(HISS_TYPE(a) != HISS_USR) return hiss_val_str(hiss_type_name(HISS_TYPE(a)));
 
     v = (hiss_val*) hiss_env_type_get(e, a->type_name);
     if(v){
@@ -710,7 +1408,7 @@ static hiss_val* builtin_shell(hiss_env* e, hiss_val* a){
         HISS_ASSERT_TYPE("shell", a, i, HISS_STR);
 
     for(i = 0; i < a->count; i++){
-        status = system(a->cells[i]->str);
+        status = system(hiss_val_cstr(a->cells[i]));
         if(status == -1) return hiss_err("system call errored.");
     }
 
@@ -718,14 +1416,53 @@ static hiss_val* builtin_shell(hiss_env* e, hiss_val* a){
 }
 
 
+/* Every builtin added so far, under the name it was added with. */
+static struct{
+  const char* name;
+  hiss_builtin fun;
+}* builtins = NULL;
+static unsigned int nbuiltins = 0;
+
+static void register_builtin(const char* name, hiss_builtin fun){
+  if(hiss_builtin_named(name)) return;
+
+  /* capacity is always the next power of two */
+  if((nbuiltins & (nbuiltins - 1)) == 0)
+    builtins = realloc(builtins, sizeof(*builtins) * (nbuiltins ? nbuiltins * 2 : 1));
+
+  builtins[nbuiltins].name = name;
+  builtins[nbuiltins].fun = fun;
+  nbuiltins++;
+}
+
+const char* hiss_builtin_name(hiss_builtin fun){
+  unsigned int i;
+
+  for(i = 0; i < nbuiltins; i++)
+    if(builtins[i].fun == fun) return builtins[i].name;
+
+  return NULL;
+}
+
+hiss_builtin hiss_builtin_named(const char* name){
+  unsigned int i;
+
+  for(i = 0; i < nbuiltins; i++)
+    if(builtins[i].name == name) return builtins[i].fun;
+
+  return NULL;
+}
+
 void hiss_env_add_builtin(hiss_env* e, const char* name, hiss_builtin fun){
   hiss_val* k = hiss_val_sym(name);
   hiss_val* v = hiss_val_fun(fun);
+
+  register_builtin(k->sym, fun);
   hiss_env_put(e, k, v);
 }
 
 void hiss_env_add_type(hiss_env* e, hiss_val* type){
-    if(type->type != HISS_USR) return;
+    if(HISS_TYPE(type) != HISS_USR) return;
 
     hiss_env_type_put(e, type->type_name, type);
 }
@@ -745,7 +1482,7 @@ static hiss_val* builtin_const(hiss_env* e, hiss_val* a){
       if(expected != actual) 
           return hiss_err("Type %s expects %i arguments, got %i", a->cells[0]->sym, expected, actual);
 
-    formals = hiss_val_pop(v, 0);
+    formals = v->formals;
   
      //And now?
   }
@@ -758,15 +1495,15 @@ static hiss_val* builtin_from(hiss_env* e, hiss_val* a){
   hiss_val* y = NULL;
   unsigned int i;
   unsigned short found = HISS_FALSE;
-  if(a->cells[0]->type == HISS_SYM && a->cells[1]->type == HISS_SYM){
+  if(HISS_TYPE(a->cells[0]) == HISS_SYM && HISS_TYPE(a->cells[1]) == HISS_SYM){
     x = (hiss_val*) hiss_env_get(e, a->cells[0]);
     
-    if(x->type == HISS_ERR){
+    if(HISS_TYPE(x) == HISS_ERR){
         x = hiss_err("Symbol %s could not be found in environment.", a->cells[0]->sym);
     } else {
         for(i = 0; i < x->formals->count; i++){
-            y = hiss_val_pop(x->formals, 0);
-            if(strcmp(y->sym, a->cells[1]->sym) == 0){
+            y = x->formals->cells[i];
+            if(y->sym == a->cells[1]->sym){
                 x = y;
                 found = HISS_TRUE;
                 break;
@@ -776,8 +1513,6 @@ static hiss_val* builtin_from(hiss_env* e, hiss_val* a){
             x = hiss_err("Symbol %s could not be found in %s.", a->cells[0]->sym, x->sym);
     }
 
-    hiss_val_del(a);
-    hiss_val_del(y);
     return x;
   }
   return hiss_err("Both arguments to from must be symbols.");
@@ -801,7 +1536,7 @@ static hiss_val* builtin_show(hiss_env* e, hiss_val* a){
 
     for (i = 0; i < a->count; i++) HISS_ASSERT_TYPE("show", a, i, HISS_STR);
 
-    for(i = 0; i < a->count; i++) printf("%s ", a->cells[i]->str);
+    for(i = 0; i < a->count; i++) printf("%.*s ", (int) a->cells[i]->count, a->cells[i]->str);
 
     putchar('\n');
 
@@ -816,7 +1551,10 @@ static hiss_val* builtin_read(hiss_env* e, hiss_val* a) {
   HISS_ASSERT_NUM("read", a, 1);
   HISS_ASSERT_TYPE("read", a, 0, HISS_STR);
 
-  if(mpc_parse("input", a->cells[0]->str, hiss, &r)){
+  val = hiss_read(hiss_val_cstr(a->cells[0]));
+  if(val){
+      val->type = HISS_QEXPR;
+  }else if(mpc_parse("input", hiss_val_cstr(a->cells[0]), hiss, &r)){
       val = hiss_val_read(r.output);
       val->type = HISS_QEXPR;
       mpc_ast_delete(r.output);
@@ -825,6 +1563,7 @@ static hiss_val* builtin_read(hiss_env* e, hiss_val* a) {
       mpc_err_delete(r.error);
 
       val = hiss_err("Could not load library: %s", err_msg);
+      free(err_msg);
   }
 
   return val;
@@ -836,82 +1575,178 @@ static hiss_val* builtin_error(hiss_env* e, hiss_val* a){
     HISS_ASSERT_NUM("error", a, 1);
     HISS_ASSERT_TYPE("error", a, 0, HISS_STR);
 
-    err_message = hiss_err(a->cells[0]->str);
+    err_message = hiss_err("%s", hiss_val_cstr(a->cells[0]));
 
-    hiss_val_del(a);
     return err_message;
 }
 
-static char* handle_file(char* name) {
-  unsigned long len = strlen(name);
-  char* new = NULL;
+/*
+ * The file load means by name: name.his, or name/module.his for a
+ * directory, made absolute so that every name of a file maps to the
+ * same path. The path as given where it cannot be resolved.
+ */
+static char* handle_file(const char* name) {
+  size_t len = strlen(name);
+  const char* suffix = ".his";
+  char* path;
+  char* canon;
 
-  if (len > 4 && strcmp(name + len - 4, ".his") == 0) {
-    new = malloc(sizeof(char*) * (len - 3));
-    memcpy(new, name, len-4);
-    new[len-3] = '\0';
-  } else {
-    new = malloc(sizeof(char*) * (len + 1));
-    memcpy(new, name, len);
-    new[len] = '\0';
-  }
+  if (len > 4 && strcmp(name + len - 4, ".his") == 0) len -= 4;
+  if (len > 0 && name[len-1] == '/') suffix = "module.his";
 
-  len = strlen(new);
+  path = malloc(len + strlen(suffix) + 1);
+  memcpy(path, name, len);
+  strcpy(path + len, suffix);
 
-  if (new[len-1] == '/') {
-    char* tmp = malloc(sizeof(char*) * (len + 10));
-    strcat(tmp, new);
-    strcat(tmp, "module.his");
-    free(new);
-    return tmp;
-  }
+#ifndef _WIN32
+  canon = realpath(path, NULL);
+#else
+  canon = _fullpath(NULL, path, 0);
+#endif
 
-  char* tmp = malloc(sizeof(char*) * (len + 4));
-  strcat(tmp, new);
-  strcat(tmp, ".his");
-  free(new);
+  if (!canon) return path;
 
-  return tmp;
+  free(path);
+  return canon;
 }
 
-hiss_val* builtin_load(hiss_env* e, hiss_val* a){
+/*
+ * The contents of the file name, terminated, and their length in len;
+ * NULL if it cannot be read.
+ */
+static char* read_file(const char* name, size_t* len){
+    FILE* f = fopen(name, "rb");
+    hiss_buffer* b;
+    char* contents;
+    char chunk[4096];
+    size_t n;
+
+    if(!f) return NULL;
+
+    b = hiss_buffer_new(sizeof(chunk));
+    while((n = fread(chunk, 1, sizeof(chunk), f)) > 0) hiss_buffer_append(b, chunk, n);
+
+    *len = b->len;
+    contents = ferror(f) ? NULL : hiss_buffer_take(b);
+
+    fclose(f);
+    hiss_buffer_delete(b);
+
+    return contents;
+}
+
+/*
+ * The expressions in the file fname: from its image where that is up
+ * to date, else read with hiss_read and saved to the image, or parsed
+ * by mpc where hiss_read fails, for mpc's error message.
+ */
+static hiss_val* read_file_exprs(const char* fname){
     mpc_result_t r;
     hiss_val* expr = NULL;
-    hiss_val* x = NULL;
+    size_t len = 0;
+    char* contents = read_file(fname, &len);
+    char* image = NULL;
     char* err_msg = NULL;
-    char* fname = NULL;
+    uint64_t hash;
 
-    HISS_ASSERT_NUM("load", a, 1);
-    HISS_ASSERT_TYPE("load", a, 0, HISS_STR);
+    if(contents){
+        hash = hiss_hash_bytes(contents, len);
+        image = hiss_image_name(fname);
 
-    fname = handle_file(a->cells[0]->str);
+        expr = hiss_image_load(image, len, hash);
+        if(!expr){
+            expr = hiss_read(contents);
+            if(expr) hiss_image_save(image, expr, len, hash);
+        }
+
+        free(image);
+        free(contents);
+
+        if(expr) return expr;
+    }
 
     if(mpc_parse_contents(fname, hiss, &r)){
         expr = hiss_val_read(r.output);
         mpc_ast_delete(r.output);
 
-        while(expr->count){
-            x = hiss_val_eval(e, hiss_val_pop(expr, 0));
+        return expr;
+    }
 
-            if(x->type == HISS_ERR) hiss_val_println(x);
+    err_msg = mpc_err_string(r.error);
+    mpc_err_delete(r.error);
 
-            hiss_val_del(x);
-        }
+    expr = hiss_err("Could not load library: %s", err_msg);
+    free(err_msg);
+
+    return expr;
+}
 
-        hiss_val_del(expr);
-        hiss_val_del(a);
+/* The modules loaded so far, by the interned path handle_file gives them. */
+static hiss_hashtable* modules = NULL;
 
-        return hiss_val_bool(HISS_TRUE);
-    } else {
-        err_msg = mpc_err_string(r.error);
-        mpc_err_delete(r.error);
+hiss_hashtable* hiss_modules(){
+    if(!modules) modules = hiss_table_new();
+    return modules;
+}
+
+/* Reads and evaluates the module at fname, printing what fails in it. */
+static hiss_val* load_module(hiss_env* e, const char* fname){
+    unsigned int i;
+    hiss_val* expr = read_file_exprs(fname);
+    hiss_val* x = NULL;
+    hiss_val* y = NULL;
 
-        x = hiss_err("Could not load library: %s", err_msg);
+    if(HISS_TYPE(expr) == HISS_ERR) return expr;
 
-        hiss_val_del(a);
+    hiss_gc_protect(expr);
+    for(i = 0; (y = hiss_val_next(expr, &i)); ){
+        x = hiss_val_eval(e, y);
 
-        return x;
+        if(HISS_TYPE(x) == HISS_ERR) hiss_val_println(x);
     }
+    hiss_gc_unprotect(1);
+
+    return hiss_val_bool(HISS_TRUE);
+}
+
+/*
+ * Loads the module called name unless it is loaded already, or again if
+ * reload is set. A module counts as loaded from the start of its first
+ * load, so modules loading each other load once each.
+ */
+static hiss_val* load(hiss_env* e, const char* name, int reload){
+    hiss_val* x;
+    char* fname = handle_file(name);
+    const char* key = hiss_intern(fname);
+    int loaded;
+
+    free(fname);
+
+    loaded = hiss_table_get(hiss_modules(), key) != NULL;
+    if(loaded && !reload) return hiss_val_bool(HISS_TRUE);
+    if(!loaded) hiss_table_insert(modules, key, hiss_val_bool(HISS_TRUE));
+
+    if(reload) reloading++;
+    x = load_module(e, key);
+    if(reload) reloading--;
+
+    if(HISS_TYPE(x) == HISS_ERR && !loaded) hiss_table_remove(modules, key);
+
+    return x;
+}
+
+hiss_val* builtin_load(hiss_env* e, hiss_val* a){
+    HISS_ASSERT_NUM("load", a, 1);
+    HISS_ASSERT_TYPE("load", a, 0, HISS_STR);
+
+    return load(e, hiss_val_cstr(a->cells[0]), 0);
+}
+
+static hiss_val* builtin_reload(hiss_env* e, hiss_val* a){
+    HISS_ASSERT_NUM("reload", a, 1);
+    HISS_ASSERT_TYPE("reload", a, 0, HISS_STR);
+
+    return load(e, hiss_val_cstr(a->cells[0]), 1);
 }
 
 void hiss_env_add_builtins(hiss_env* e){
@@ -919,6 +1754,8 @@ void hiss_env_add_builtins(hiss_env* e){
   hiss_env_add_builtin(e, "del!", builtin_del);
   hiss_env_add_builtin(e, "=", builtin_put);
   hiss_env_add_builtin(e, "lambda", builtin_lambda);
+  hiss_env_add_builtin(e, "fun", builtin_fun);
+  hiss_env_add_builtin(e, "let", builtin_let);
 
   hiss_env_add_builtin(e, "if", builtin_if);
   hiss_env_add_builtin(e, "==", builtin_eq);
@@ -940,7 +1777,9 @@ void hiss_env_add_builtins(hiss_env* e){
   hiss_env_add_builtin(e, "tail", builtin_tail);
   hiss_env_add_builtin(e, "eval", builtin_eval);
   hiss_env_add_builtin(e, "join", builtin_join);
+  hiss_env_add_builtin(e, "substr", builtin_substr);
   hiss_env_add_builtin(e, "load", builtin_load);
+  hiss_env_add_builtin(e, "reload", builtin_reload);
   hiss_env_add_builtin(e, "type?", builtin_type);
   hiss_env_add_builtin(e, "const", builtin_const);
   hiss_env_add_builtin(e, "from", builtin_from);
@@ -950,6 +1789,47 @@ void hiss_env_add_builtins(hiss_env* e){
   hiss_env_add_builtin(e, "show", builtin_show);
   hiss_env_add_builtin(e, "read", builtin_read);
 
+  /*
+   * (vec) evaluates to the builtin itself, like any one-cell
+   * S-Expression does; an empty vector is (list->vec {}).
+   */
+  hiss_env_add_builtin(e, "vec", builtin_vec);
+  hiss_env_add_builtin(e, "vec-len", builtin_vec_len);
+  hiss_env_add_builtin(e, "vec-get", builtin_vec_get);
+  hiss_env_add_builtin(e, "vec-set!", builtin_vec_set);
+  hiss_env_add_builtin(e, "vec-push!", builtin_vec_push);
+  hiss_env_add_builtin(e, "vec-slice", builtin_vec_slice);
+  hiss_env_add_builtin(e, "vec->list", builtin_vec_to_list);
+  hiss_env_add_builtin(e, "list->vec", builtin_list_to_vec);
+
+  /* (dict) is the builtin itself, as with vec; (dict-new 0) is empty. */
+  hiss_env_add_builtin(e, "dict", builtin_dict);
+  hiss_env_add_builtin(e, "dict-new", builtin_dict_new);
+  hiss_env_add_builtin(e, "dict-size", builtin_dict_size);
+  hiss_env_add_builtin(e, "dict-get", builtin_dict_get);
+  hiss_env_add_builtin(e, "dict-has?", builtin_dict_has);
+  hiss_env_add_builtin(e, "dict-put!", builtin_dict_put);
+  hiss_env_add_builtin(e, "dict-remove!", builtin_dict_remove);
+  hiss_env_add_builtin(e, "dict-keys", builtin_dict_keys);
+  hiss_env_add_builtin(e, "dict-items", builtin_dict_items);
+
+  /* (buffer) is the builtin itself, as with vec; (buffer "") is empty. */
+  hiss_env_add_builtin(e, "buffer", builtin_buffer);
+  hiss_env_add_builtin(e, "buffer-append!", builtin_buffer_append);
+  hiss_env_add_builtin(e, "buffer-len", builtin_buffer_len);
+  hiss_env_add_builtin(e, "buffer->str", builtin_buffer_to_str);
+
+  hiss_env_add_builtin(e, "len", builtin_len);
+  hiss_env_add_builtin(e, "reverse", builtin_reverse);
+  hiss_env_add_builtin(e, "nth", builtin_nth);
+  hiss_env_add_builtin(e, "last", builtin_last);
+  hiss_env_add_builtin(e, "foldl", builtin_foldl);
+  hiss_env_add_builtin(e, "foldr", builtin_foldr);
+  hiss_env_add_builtin(e, "map", builtin_map);
+  hiss_env_add_builtin(e, "sum", builtin_sum);
+  hiss_env_add_builtin(e, "product", builtin_product);
+  hiss_env_add_builtin(e, "range", builtin_range);
+
   hiss_env_add_builtin(e, "+", builtin_add);
   hiss_env_add_builtin(e, "-", builtin_sub);
   hiss_env_add_builtin(e, "*", builtin_mul);
@@ -967,66 +1847,102 @@ const char* hiss_type_name(int t){
         case HISS_SYM: return "Symbol";
         case HISS_SEXPR: return "S-Expression";
         case HISS_QEXPR: return "Q-Expression";
+        case HISS_VEC: return "Vector";
+        case HISS_DICT: return "Dictionary";
+        case HISS_BUF: return "Buffer";
         default: return "Unknown";
     }
 }
 
-static hiss_val* hiss_val_call(hiss_env* e, hiss_val* f, hiss_val* a){
+/* The interned "&", which marks the rest of the formals as variadic. */
+static const char* hiss_amp(){
+    static const char* amp = NULL;
+
+    if(!amp) amp = hiss_intern("&");
+    return amp;
+}
+
+hiss_val* hiss_val_activate(const hiss_val* f){
+    hiss_val* c = hiss_val_alloc(HISS_FUN);
+
+    c->env = hiss_env_copy(f->env);
+    /* binding takes the formals off the view, not off f's */
+    c->formals = hiss_val_view(f->formals, 0, f->formals->count);
+    c->body = f->body;
+    c->code = hiss_chunk_retain(f->code);
+
+    return c;
+}
+
+hiss_val* hiss_val_bind(hiss_env* e, hiss_val* f, hiss_val* a){
     unsigned int actual = a->count;
     unsigned int expected = 0;
     hiss_val* sym = NULL;
     hiss_val* nsym = NULL;
     hiss_val* val = NULL;
 
-    if(f->fun) return f->fun(e, a);
     if(f->formals) expected = f->formals->count;
 
     while(a->count){
-        sym = hiss_val_pop(f->formals, 0);
+        if(f->formals->count == 0){
+            return hiss_err("Function passed too many arguments. Got %i, expected %i.",
+                            actual, expected);
+        }
+
+        sym = hiss_val_shift(f->formals);
 
-        if (strcmp(sym->sym, "&") == 0) {
+        if (sym->sym == hiss_amp()) {
             if (f->formals->count != 1) {
-                hiss_val_del(a);
                 return hiss_err("Function format invalid. Symbol '&' not followed by single symbol.");
             }
 
-            nsym = hiss_val_pop(f->formals, 0);
+            nsym = hiss_val_shift(f->formals);
             hiss_env_put(f->env, nsym, builtin_list(e, a));
             break;
         }
-        val = hiss_val_pop(a, 0);
-
-        if(expected == 0){
-            hiss_val_del(a);
-            return hiss_err("Function passed too many arguments. Got %i, expected %i.",
-                            actual, expected);
-        }
-
+        val = hiss_val_shift(a);
 
         hiss_env_put(f->env, sym, val);
     }
 
-    if(f->formals->count > 0 && strcmp(f->formals->cells[0]->sym, "&") == 0){
+    if(f->formals->count > 0 && f->formals->cells[0]->sym == hiss_amp()){
         if(f->formals->count != 2)
             return hiss_err("Function format invalid. Symbol '&' not followed by single symbol.");
 
-        hiss_val_del(hiss_val_pop(f->formals, 0));
+        hiss_val_shift(f->formals);
 
-        sym = hiss_val_pop(f->formals, 0);
+        sym = hiss_val_shift(f->formals);
         val = hiss_val_qexpr();
 
         hiss_env_put(f->env, sym, val);
     }
 
     if(f->formals->count == 0){
-        f->env->par = e;
-        return builtin_eval(f->env, hiss_val_add(hiss_val_sexpr(), hiss_val_copy(f->body)));
+        if(!f->code) f->code = hiss_compile_body(f->body);
+        return NULL;
     }
     
-    return hiss_val_copy(f);
+    return f;
+}
+
+hiss_val* hiss_val_call(hiss_env* e, hiss_val* f, hiss_val* a){
+    hiss_val* x = NULL;
+
+    if(f->fun) return f->fun(e, a);
+
+    f = hiss_val_activate(f);
+    x = hiss_val_bind(e, f, a);
+    if(x) return x;
+
+    hiss_gc_protect(f);
+    x = hiss_vm_run(f->env, f->code);
+    hiss_gc_unprotect(1);
+
+    return x;
 }
 
 #undef HISS_ASSERT
 #undef HISS_ASSERT_TYPE
 #undef HISS_ASSERT_NUM
+#undef HISS_ASSERT_KEY
 #undef HISS_ASSERT_NON_EMPTY
@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <string.h>
 
+#include "hiss_cells.h"
 #include "hiss_hash.h"
 #include "hiss_type_table.h"
 #include "util.h"
@@ -27,6 +28,16 @@ hiss_val* hiss_val_read(mpc_ast_t* t);
 void hiss_val_print(hiss_val* val);
 void hiss_val_println(hiss_val* val);
 hiss_val* hiss_val_pop(hiss_val* v, unsigned int i);
+/* Removes the first cell of v and returns it, in constant time. */
+hiss_val* hiss_val_shift(hiss_val* v);
+
+/*
+ * The cell of v at *i, advancing *i; NULL past the last one. Walks v
+ * without consuming it: for(i = 0; (x = hiss_val_next(v, &i)); ).
+ */
+static __inline hiss_val* hiss_val_next(const hiss_val* v, unsigned int* i){
+  return *i < v->count ? v->cells[(*i)++] : NULL;
+}
 hiss_val* hiss_val_take(hiss_val* v, unsigned int i);
 hiss_val* hiss_val_copy(const hiss_val* val);
 const hiss_val* hiss_env_get(hiss_env* e, hiss_val* k);
@@ -38,9 +49,18 @@ const hiss_val* hiss_env_put(hiss_env* e, hiss_val* k, hiss_val* v);
  */
 
 void hiss_env_add_builtin(hiss_env* e, const char* name, hiss_builtin fun);
+/* The interned name fun was added under as a builtin, NULL for none. */
+const char* hiss_builtin_name(hiss_builtin fun);
+/* The builtin added under the interned name, NULL for none. */
+hiss_builtin hiss_builtin_named(const char* name);
+/* The modules load has loaded, as true by their interned paths. */
+hiss_hashtable* hiss_modules();
 void hiss_env_add_builtins(hiss_env* e);
 void hiss_env_add_type(hiss_env* e, hiss_val* a);
 hiss_val* builtin_load(hiss_env* e, hiss_val* a);
+hiss_val* builtin_if(hiss_env* e, hiss_val* a);
+hiss_val* builtin_eval(hiss_env* e, hiss_val* a);
+const char* hiss_type_name(int t);
 
 /*
  * Evaluation functions
@@ -48,6 +68,15 @@ hiss_val* builtin_load(hiss_env* e, hiss_val* a);
 hiss_val* hiss_val_eval_sexpr(hiss_env* e, hiss_val* v);
 hiss_val* hiss_val_eval(hiss_env* e, hiss_val* v);
 
+/*
+ * Values are shared once built, lambdas are the exception: a call binds
+ * its arguments in a fresh activation of the lambda made by
+ * hiss_val_activate, which hiss_val_bind then fills in place.
+ */
+hiss_val* hiss_val_activate(const hiss_val* f);
+hiss_val* hiss_val_bind(hiss_env* e, hiss_val* f, hiss_val* a);
+hiss_val* hiss_val_call(hiss_env* e, hiss_val* f, hiss_val* a);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,7 +10,7 @@
 #define GC_TRESHOLD 500
 
 enum {HISS_ERR, HISS_NUM, HISS_BOOL, HISS_SYM, HISS_FUN, 
-      HISS_SEXPR, HISS_QEXPR, HISS_STR, HISS_USR};
+      HISS_SEXPR, HISS_QEXPR, HISS_STR, HISS_USR, HISS_VEC, HISS_DICT, HISS_BUF};
 
 enum {HISS_FALSE, HISS_TRUE};
 
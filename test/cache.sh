@@ -0,0 +1,45 @@
+#!/bin/sh
+# The .hisc images load keeps next to a module: written on the first
+# load, reused while the source is unchanged, and replaced once it
+# changes, even keeping its size and mtime, or once the image is broken.
+# Takes the interpreter as its argument.
+hiss=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+fail(){
+    echo "[x] cache.sh: $1"
+    exit 1
+}
+
+run(){
+    got=$("$hiss" "$dir/main.his" 2>&1)
+    [ "$got" = "$1 " ] || fail "$2: got '$got', expected '$1 '"
+}
+
+inode(){
+    ls -i "$dir/m.hisc" | cut -d ' ' -f 1
+}
+
+printf '(def {x} 1)\n' > "$dir/m.his"
+printf '(load "%s/m")\n(print x)\n' "$dir" > "$dir/main.his"
+
+run 1 "first load"
+[ -f "$dir/m.hisc" ] || fail "no image written"
+image=$(inode)
+
+run 1 "load from the image"
+[ "$(inode)" = "$image" ] || fail "image rewritten though the source is unchanged"
+
+printf '(def {x} 2)\n' > "$dir/new"
+touch -r "$dir/m.his" "$dir/new"
+mv "$dir/new" "$dir/m.his"
+run 2 "source changed, same size and mtime"
+[ "$(inode)" != "$image" ] || fail "stale image kept"
+
+head -c 10 "$dir/m.hisc" > "$dir/broken"
+mv "$dir/broken" "$dir/m.hisc"
+run 2 "truncated image"
+
+printf 'not an image at all, but long enough for a header' > "$dir/m.hisc"
+run 2 "garbage image"
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Heap images: what a program defined comes back from its image, with
+# compiled code, closures, promoted frames, dictionaries, vectors and
+# slices; a truncated or altered image is rejected without running the
+# program. Takes the interpreter as its argument.
+hiss=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+fail(){
+    echo "[x] image.sh: $1"
+    exit 1
+}
+
+cat > "$dir/define.his" <<'END'
+(fun {do & l} {last l})
+(fun {fact n} {if (== n 0) {1} {* n (fact (- n 1))}})
+(fun {maybe n} {if (> n 0) {n}})
+(fun {many _} {do (= {a} 1) (= {b} 2) (= {c} 3) (= {d} 4) (= {e} 5)
+                  (= {f} 6) (= {g} 7) (= {h} 8) (= {i} 9) (= {j} 10)
+                  (lambda {x} {+ x a j})})
+(def {closure} (many 0))
+(def {counter} (let {do (= {n} 41) (lambda {x} {+ n x})}))
+(def {dict-of} (dict "k" {1 2} 3 "three"))
+(def {vector} (list->vec {1 2 3}))
+(def {slice} (substr "hello world" 6 5))
+END
+
+cat > "$dir/use.his" <<'END'
+(print (fact 10) (maybe 3) (maybe -3))
+(print (closure 1) (counter 1))
+(print (dict-get dict-of "k") (dict-get dict-of 3) vector slice)
+END
+
+want='3628800 3 {} 
+12 42 
+{1 2} "three" [1 2 3] "world" '
+
+"$hiss" --dump-image "$dir/heap.img" "$dir/define.his" > /dev/null 2>&1
+[ -s "$dir/heap.img" ] || fail "no image written"
+
+got=$("$hiss" --image "$dir/heap.img" "$dir/use.his" 2>&1)
+[ "$got" = "$want" ] || fail "restored image gave '$got'"
+
+size=$(wc -c < "$dir/heap.img")
+for n in 0 16 40 $((size / 2)) $((size - 1)); do
+    head -c "$n" "$dir/heap.img" > "$dir/cut.img"
+    got=$("$hiss" --image "$dir/cut.img" "$dir/use.his" 2>&1) && fail "image cut to $n bytes accepted"
+    case "$got" in
+        *"Could not restore image"*) ;;
+        *) fail "image cut to $n bytes: '$got'" ;;
+    esac
+done
+
+# one byte changed in the middle no longer matches the hash in the header
+head -c $((size / 2)) "$dir/heap.img" > "$dir/bad.img"
+printf 'X' >> "$dir/bad.img"
+tail -c +$((size / 2 + 2)) "$dir/heap.img" >> "$dir/bad.img"
+[ "$(wc -c < "$dir/bad.img")" -eq "$size" ] || fail "could not alter the image"
+cmp -s "$dir/bad.img" "$dir/heap.img" && fail "could not alter the image"
+"$hiss" --image "$dir/bad.img" "$dir/use.his" > /dev/null 2>&1 && fail "altered image accepted"
+
+exit 0
@@ -0,0 +1,51 @@
+#!/bin/sh
+# load reads each module once, however its path is spelled, and modules
+# loading each other once each; a module it could not read is tried
+# again. reload reads a module again and rebinds its globals in place.
+# Takes the interpreter as its argument.
+hiss=$1
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+printf '(print "m")\n(def {x} 1)\n' > "$dir/m.his"
+printf '(print "m again")\n(def {x} 2)\n' > "$dir/m2.his"
+printf '(print "late")\n' > "$dir/l.his"
+printf '(print "a")\n(load "%s/b")\n' "$dir" > "$dir/a.his"
+printf '(print "b")\n(load "%s/a")\n' "$dir" > "$dir/b.his"
+
+cat > "$dir/main.his" <<END
+(load "$dir/m")
+(load "$dir/m.his")
+(load "$dir/../$(basename "$dir")/m")
+(fun {get-x _} {x})
+(print (get-x 0))
+(shell "cp $dir/m2.his $dir/m.his")
+(load "$dir/m")
+(print (get-x 0))
+(reload "$dir/m")
+(print (get-x 0) x)
+(load "$dir/a")
+(load "$dir/b")
+(load "$dir/late")
+(shell "cp $dir/l.his $dir/late.his")
+(load "$dir/late")
+(load "$dir/late")
+END
+
+got=$("$hiss" "$dir/main.his" 2>&1 | sed "s#$dir#DIR#g")
+want='"m" 
+1 
+1 
+"m again" 
+2 2 
+"a" 
+"b" 
+[x] Error: Could not load library: DIR/late.his: error: Unable to open file!
+
+"late" '
+
+if [ "$got" != "$want" ]; then
+    echo "[x] load.sh: got"
+    echo "$got"
+    exit 1
+fi